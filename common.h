@@ -27,18 +27,66 @@
 
 #pragma once
 
+#ifdef __KERNEL__
+
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/netdevice.h>
+#include <linux/if_arp.h>
 #include <linux/etherdevice.h>
+#include <linux/if_vlan.h>
 #include <linux/init.h>
 #include <linux/moduleparam.h>
 #include <linux/rtnetlink.h>
 #include <net/rtnetlink.h>
+#include <net/net_namespace.h>
+#include <net/netns/generic.h>
 #include <linux/u64_stats_sync.h>
 #include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/ethtool.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/icmp.h>
+#include <linux/icmpv6.h>
+#include <net/checksum.h>
+#include <net/ip6_checksum.h>
+#include <net/ndisc.h>
+#include <net/addrconf.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/mld.h>
+#include <linux/igmp.h>
+#include <linux/inetdevice.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
+#include <linux/vmalloc.h>
+#include <linux/hashtable.h>
+#include <linux/mutex.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/workqueue.h>
+#include <linux/udp.h>
+#include <linux/ctype.h>
+#include <linux/inet.h>
+#include <asm/unaligned.h>
 
 #include "net_util.h"
 
+#else
+
+#include "net_user.h"
+#include "net_util.h"
+
+#endif
+
+#ifdef DUMMY_DEBUG
 #define N_DEBUG(format) printk(format)
 #define N_DEBUG_F(format, ...) printk(format, __VA_ARGS__)
+#else
+#define N_DEBUG(format) do {} while(0)
+#define N_DEBUG_F(format, ...) do {} while(0)
+#endif
@@ -0,0 +1,107 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#include "common.h"
+
+#include "net_bench.h"
+
+static unsigned int bench_ip_c(unsigned char *data, u8 protocol, unsigned int len, __be32 source, __be32 destination) {
+    struct iphdr *header = (struct iphdr *) data;
+
+    header->version = 4;
+    header->ihl = 5;
+    header->tot_len = htons(sizeof(struct iphdr) + len);
+    header->frag_off = htons(IP_DF);
+    header->ttl = 64;
+    header->protocol = protocol;
+    header->saddr = source;
+    header->daddr = destination;
+    header->check = ip_fast_csum((unsigned char *) header, header->ihl);
+
+    return sizeof(struct iphdr);
+}
+
+unsigned int bench_frame_c(
+    unsigned char *buffer,
+    unsigned int kind,
+    const unsigned char *source_mac,
+    const unsigned char *destination_mac,
+    __be32 source,
+    __be32 destination
+) {
+    struct ethhdr *ethernet = (struct ethhdr *) buffer;
+    unsigned char *data = &(buffer[ETH_HLEN]);
+    struct icmphdr *icmp;
+    struct udphdr *udp;
+    unsigned int len;
+
+    memset(buffer, 0, BENCH_FRAME_SIZE);
+    memcpy(ethernet->h_source, source_mac, MAC_ADDRESS_SIZE);
+
+    switch(kind) {
+        case BENCH_KIND_ARP:
+            /* builds a broadcast (who has) request for the address
+            of the device in the ethernet/ipv4 arp format */
+            eth_broadcast_addr(ethernet->h_dest);
+            ethernet->h_proto = htons(ETH_P_ARP);
+            data[1] = 0x01;
+            data[2] = 0x08;
+            data[4] = MAC_ADDRESS_SIZE;
+            data[5] = IP_ADDRESS_SIZE;
+            data[7] = 0x01;
+            memcpy(&(data[8]), source_mac, MAC_ADDRESS_SIZE);
+            memcpy(&(data[14]), &source, IP_ADDRESS_SIZE);
+            memcpy(&(data[24]), &destination, IP_ADDRESS_SIZE);
+            return ETH_HLEN + ARP_PACKET_SIZE;
+
+        case BENCH_KIND_ICMP:
+            memcpy(ethernet->h_dest, destination_mac, MAC_ADDRESS_SIZE);
+            ethernet->h_proto = htons(ETH_P_IP);
+            len = sizeof(struct icmphdr) + BENCH_PAYLOAD_SIZE;
+            icmp = (struct icmphdr *) &(data[bench_ip_c(data, IPPROTO_ICMP, len, source, destination)]);
+            icmp->type = ICMP_ECHO;
+            icmp->un.echo.id = htons(1);
+            icmp->un.echo.sequence = htons(1);
+            icmp->checksum = ip_compute_csum(icmp, len);
+            return ETH_HLEN + sizeof(struct iphdr) + len;
+
+        case BENCH_KIND_UDP:
+            memcpy(ethernet->h_dest, destination_mac, MAC_ADDRESS_SIZE);
+            ethernet->h_proto = htons(ETH_P_IP);
+            len = sizeof(struct udphdr) + BENCH_PAYLOAD_SIZE;
+            udp = (struct udphdr *) &(data[bench_ip_c(data, IPPROTO_UDP, len, source, destination)]);
+            udp->source = htons(BENCH_PORT);
+            udp->dest = htons(BENCH_PORT);
+            udp->len = htons(len);
+            udp->check = csum_tcpudp_magic(source, destination, len, IPPROTO_UDP, csum_partial(udp, len, 0));
+            if(udp->check == 0) { udp->check = CSUM_MANGLED_0; }
+            return ETH_HLEN + sizeof(struct iphdr) + len;
+
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#pragma once
+
+#define BENCH_KIND_ARP 0
+#define BENCH_KIND_ICMP 1
+#define BENCH_KIND_UDP 2
+#define BENCH_KINDS 3
+
+#define BENCH_FRAME_SIZE 128
+#define BENCH_PAYLOAD_SIZE 32
+#define BENCH_PORT 9
+
+/**
+ * Builds a (synthetic) request frame of the provided kind into
+ * the buffer, the frame is a request from the device (as if sent
+ * by the stack) to a peer in its sub network.
+ *
+ * @param buffer The buffer (of BENCH_FRAME_SIZE bytes) for the frame.
+ * @param kind The kind of the frame (arp, icmp or udp).
+ * @param source_mac The mac address of the device.
+ * @param destination_mac The mac address of the peer.
+ * @param source The address of the device.
+ * @param destination The address of the peer.
+ * @return The size of the frame, including the mac header.
+ */
+unsigned int bench_frame_c(
+    unsigned char *buffer,
+    unsigned int kind,
+    const unsigned char *source_mac,
+    const unsigned char *destination_mac,
+    __be32 source,
+    __be32 destination
+);
@@ -0,0 +1,385 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#include "common.h"
+
+#include "net_canned.h"
+
+/**
+ * Structure that defines the state of the loading of a new
+ * payload, the pages are filled as the payload is written
+ * and it's only published once the file is closed.
+ */
+struct canned_builder {
+    struct canned_context *context;
+    bool loading;
+    struct page *pages[CANNED_PAGES];
+    unsigned int size;
+    int error;
+};
+
+static DEFINE_MUTEX(canned_mutex);
+
+static void canned_pages_free_c(struct page **pages, unsigned int count) {
+    unsigned int index;
+
+    for(index = 0; index < count; index++) {
+        if(pages[index] == NULL) { continue; }
+        put_page(pages[index]);
+    }
+}
+
+static void canned_blob_free_c(struct canned_blob *blob) {
+    /* only the references of the payload are dropped, the pages
+    are released once the last response referencing them is */
+    if(blob == NULL) { return; }
+    canned_pages_free_c(blob->pages, blob->count);
+    kfree(blob);
+}
+
+static struct canned_blob *canned_build_c(struct canned_builder *builder) {
+    struct canned_blob *blob;
+    unsigned int udp_len = sizeof(struct udphdr) + builder->size;
+    unsigned int offset = 0;
+    unsigned int index;
+    __wsum csum = 0;
+
+    blob = kzalloc(sizeof(struct canned_blob), GFP_KERNEL);
+    if(blob == NULL) { return NULL; }
+    blob->size = builder->size;
+    blob->count = DIV_ROUND_UP(builder->size, PAGE_SIZE);
+
+    /* moves the pages into the payload computing its checksum, the
+    pages are full except the last one so the offsets are even */
+    for(index = 0; index < blob->count; index++) {
+        blob->pages[index] = builder->pages[index];
+        builder->pages[index] = NULL;
+        csum = csum_partial(page_address(blob->pages[index]),
+            min_t(unsigned int, blob->size - offset, PAGE_SIZE), csum);
+        offset += PAGE_SIZE;
+    }
+
+    /* the udp checksum of the responses only differs in the ports
+    and in the addresses, the payload and the length are constant */
+    blob->udp_csum = csum_add(csum, (__force __wsum) htons(udp_len));
+
+    /* the templates of the network headers (without the addresses
+    and the identifier) and the partial checksum of the ipv4 one */
+    blob->ipv4.version = 4;
+    blob->ipv4.ihl = sizeof(struct iphdr) / 4;
+    blob->ipv4.tot_len = htons(sizeof(struct iphdr) + udp_len);
+    blob->ipv4.frag_off = htons(IP_DF);
+    blob->ipv4.ttl = CANNED_TTL;
+    blob->ipv4.protocol = IPPROTO_UDP;
+    blob->ipv4_csum = csum_partial(&blob->ipv4, sizeof(struct iphdr), 0);
+    blob->ipv6.version = 6;
+    blob->ipv6.payload_len = htons(udp_len);
+    blob->ipv6.nexthdr = IPPROTO_UDP;
+    blob->ipv6.hop_limit = CANNED_TTL;
+
+    return blob;
+}
+
+static int canned_show_c(struct seq_file *file, void *data) {
+    struct canned_builder *builder = file->private;
+    struct canned_blob *blob;
+
+    mutex_lock(&canned_mutex);
+    blob = rcu_dereference_protected(builder->context->blob, lockdep_is_held(&canned_mutex));
+    if(blob != NULL) { seq_printf(file, "size %u\npages %u\n", blob->size, blob->count); }
+    mutex_unlock(&canned_mutex);
+    return 0;
+}
+
+static int canned_open_c(struct inode *inode, struct file *file) {
+    struct canned_builder *builder;
+    int error;
+
+    /* opening the file for writing starts the loading of a new
+    payload, that replaces the current one once the file is closed */
+    builder = kzalloc(sizeof(struct canned_builder), GFP_KERNEL);
+    if(builder == NULL) { return -ENOMEM; }
+    builder->context = inode->i_private;
+    builder->loading = file->f_mode & FMODE_WRITE ? true : false;
+
+    error = single_open(file, canned_show_c, builder);
+    if(error) { kfree(builder); }
+    return error;
+}
+
+static ssize_t canned_write_c(struct file *file, const char __user *buffer, size_t count, loff_t *position) {
+    struct canned_builder *builder = ((struct seq_file *) file->private_data)->private;
+    struct page **page;
+    size_t offset = 0;
+    size_t size;
+
+    if(builder->error) { return builder->error; }
+    if(builder->size + count > CANNED_SIZE) { builder->error = -EFBIG; return -EFBIG; }
+
+    /* copies the written data into the pages of the payload, these
+    are allocated as they are needed (the payload is append only) */
+    while(offset < count) {
+        page = &builder->pages[builder->size / PAGE_SIZE];
+        if(*page == NULL) {
+            *page = alloc_page(GFP_KERNEL);
+            if(*page == NULL) { builder->error = -ENOMEM; return -ENOMEM; }
+        }
+        size = min_t(size_t, count - offset, PAGE_SIZE - builder->size % PAGE_SIZE);
+        if(copy_from_user(page_address(*page) + builder->size % PAGE_SIZE, buffer + offset, size)) {
+            builder->error = -EFAULT;
+            return -EFAULT;
+        }
+        builder->size += size;
+        offset += size;
+    }
+
+    return count;
+}
+
+static int canned_release_c(struct inode *inode, struct file *file) {
+    struct canned_builder *builder = ((struct seq_file *) file->private_data)->private;
+    struct canned_blob *previous;
+    struct canned_blob *blob = NULL;
+
+    if(!builder->loading) {
+        kfree(builder);
+        return single_release(inode, file);
+    }
+
+    /* builds the new payload, an empty payload removes the current
+    one (and the datagrams are reflected as before) */
+    if(!builder->error && builder->size > 0) {
+        blob = canned_build_c(builder);
+        if(blob == NULL) { builder->error = -ENOMEM; }
+    }
+
+    /* replaces the payload atomically, the previous one is only
+    released after the grace period of the responders using it */
+    if(!builder->error) {
+        mutex_lock(&canned_mutex);
+        previous = rcu_dereference_protected(builder->context->blob, lockdep_is_held(&canned_mutex));
+        rcu_assign_pointer(builder->context->blob, blob);
+        mutex_unlock(&canned_mutex);
+        synchronize_rcu();
+        canned_blob_free_c(previous);
+    }
+
+    canned_pages_free_c(builder->pages, CANNED_PAGES);
+    kfree(builder);
+    return single_release(inode, file);
+}
+
+static const struct file_operations canned_fops = {
+    .owner = THIS_MODULE,
+    .open = canned_open_c,
+    .read = seq_read,
+    .write = canned_write_c,
+    .llseek = seq_lseek,
+    .release = canned_release_c,
+};
+
+static int canned_ports_show_c(struct seq_file *file, void *data) {
+    struct canned_context *context = file->private;
+    unsigned int start;
+    unsigned int end;
+
+    /* prints the ports as a list of (inclusive) ranges, the
+    same format that is used to set them */
+    mutex_lock(&canned_mutex);
+    for_each_set_bit(start, context->ports, CANNED_PORTS) {
+        end = find_next_zero_bit(context->ports, CANNED_PORTS, start) - 1;
+        if(start == end) { seq_printf(file, "%u\n", start); }
+        else { seq_printf(file, "%u-%u\n", start, end); }
+        start = end;
+    }
+    mutex_unlock(&canned_mutex);
+    return 0;
+}
+
+static int canned_ports_open_c(struct inode *inode, struct file *file) {
+    return single_open(file, canned_ports_show_c, inode->i_private);
+}
+
+static ssize_t canned_ports_write_c(struct file *file, const char __user *buffer, size_t count, loff_t *position) {
+    struct canned_context *context = ((struct seq_file *) file->private_data)->private;
+    char line[CANNED_LINE_SIZE];
+    char *text = line;
+    char *token;
+    char *range;
+    unsigned long *ports;
+    u16 start = 0;
+    u16 end = 0;
+    int error = 0;
+
+    if(count >= sizeof(line)) { return -EINVAL; }
+    if(copy_from_user(line, buffer, count)) { return -EFAULT; }
+    line[count] = '\0';
+
+    /* parses the (separated) ports and ranges of ports written into
+    a new set (too large for the stack), an empty write clears it */
+    ports = kcalloc(BITS_TO_LONGS(CANNED_PORTS), sizeof(unsigned long), GFP_KERNEL);
+    if(ports == NULL) { return -ENOMEM; }
+    while((token = strsep(&text, " \t\n,")) != NULL) {
+        if(token[0] == '\0') { continue; }
+        range = strchr(token, '-');
+        if(range != NULL) { *range++ = '\0'; }
+        error = kstrtou16(token, 10, &start);
+        if(!error) { error = range ? kstrtou16(range, 10, &end) : 0; }
+        if(!error && range == NULL) { end = start; }
+        if(!error && end < start) { error = -EINVAL; }
+        if(error) { break; }
+        bitmap_set(ports, start, end - start + 1);
+    }
+
+    /* only replaces the complete set of ports in case all of the
+    written values are valid, otherwise the set is not changed */
+    if(!error) {
+        mutex_lock(&canned_mutex);
+        bitmap_copy(context->ports, ports, CANNED_PORTS);
+        mutex_unlock(&canned_mutex);
+    }
+    kfree(ports);
+
+    return error ? error : count;
+}
+
+static const struct file_operations canned_ports_fops = {
+    .owner = THIS_MODULE,
+    .open = canned_ports_open_c,
+    .read = seq_read,
+    .write = canned_ports_write_c,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+int canned_init_c(struct canned_context *context, struct dentry *root) {
+    BUILD_BUG_ON(CANNED_PAGES > MAX_SKB_FRAGS);
+
+    RCU_INIT_POINTER(context->blob, NULL);
+    context->file = NULL;
+    context->ports_file = NULL;
+    context->ports = kzalloc(BITS_TO_LONGS(CANNED_PORTS) * sizeof(unsigned long), GFP_KERNEL);
+    if(context->ports == NULL) { return -ENOMEM; }
+
+    if(root == NULL) { return 0; }
+    context->file = debugfs_create_file("canned", 0600, root, context, &canned_fops);
+    context->ports_file = debugfs_create_file("canned_ports", 0600, root, context, &canned_ports_fops);
+    return 0;
+}
+
+void canned_destroy_c(struct canned_context *context) {
+    debugfs_remove(context->ports_file);
+    debugfs_remove(context->file);
+    context->ports_file = NULL;
+    context->file = NULL;
+    canned_blob_free_c(rcu_dereference_protected(context->blob, 1));
+    RCU_INIT_POINTER(context->blob, NULL);
+    kfree(context->ports);
+    context->ports = NULL;
+}
+
+unsigned int canned_query_c(struct canned_context *context, unsigned char *data, unsigned int len) {
+    struct iphdr *header = (struct iphdr *) data;
+    struct ipv6hdr *header6 = (struct ipv6hdr *) data;
+    struct udphdr *udp;
+    unsigned int header_size;
+
+    if(rcu_access_pointer(context->blob) == NULL) { return 0; }
+
+    /* only the datagrams with a fixed size network header are
+    answered (the template replaces it), the others are reflected */
+    if(len < sizeof(struct iphdr)) { return 0; }
+    switch(header->version) {
+        case 4:
+            header_size = sizeof(struct iphdr);
+            if(header->ihl * 4 != header_size) { return 0; }
+            if(header->protocol != IPPROTO_UDP) { return 0; }
+            if(header->frag_off & htons(IP_MF | IP_OFFSET)) { return 0; }
+            if(ipv4_is_multicast(header->daddr) || ipv4_is_lbcast(header->daddr)) { return 0; }
+            break;
+
+        case 6:
+            header_size = sizeof(struct ipv6hdr);
+            if(len < header_size) { return 0; }
+            if(header6->nexthdr != IPPROTO_UDP) { return 0; }
+            if(ipv6_addr_is_multicast(&header6->daddr)) { return 0; }
+            break;
+
+        default:
+            return 0;
+    }
+
+    if(len < header_size + sizeof(struct udphdr)) { return 0; }
+    udp = (struct udphdr *) &(data[header_size]);
+    return test_bit(ntohs(udp->dest), context->ports) ? header_size : 0;
+}
+
+void canned_reflect_c(struct canned_blob *blob, unsigned char *data, unsigned int header_size) {
+    struct iphdr *header = (struct iphdr *) data;
+    struct ipv6hdr *header6 = (struct ipv6hdr *) data;
+    struct udphdr *udp = (struct udphdr *) &(data[header_size]);
+    unsigned int udp_len = sizeof(struct udphdr) + blob->size;
+    __be32 saddr;
+    __be32 daddr;
+    struct in6_addr saddr6;
+    struct in6_addr daddr6;
+    __be16 port;
+    __wsum ip_csum;
+    __wsum csum;
+
+    /* switches the ports, the checksum of the udp header and of
+    the payload is the precomputed one plus the ports */
+    port = udp->source;
+    udp->source = udp->dest;
+    udp->dest = port;
+    udp->len = htons(udp_len);
+    csum = csum_add(blob->udp_csum, (__force __wsum) (__force u32) udp->source);
+    csum = csum_add(csum, (__force __wsum) (__force u32) udp->dest);
+
+    /* replaces the network header with the template (switching
+    the addresses), only the addresses (and the per cpu identifier
+    of the datagram) are added to the checksums */
+    if(header->version == 4) {
+        saddr = header->daddr;
+        daddr = header->saddr;
+        memcpy(header, &blob->ipv4, sizeof(struct iphdr));
+        header->id = ip_ident_c();
+        header->saddr = saddr;
+        header->daddr = daddr;
+        ip_csum = csum_add(blob->ipv4_csum, (__force __wsum) (__force u32) header->id);
+        header->check = csum_fold(csum_add(ip_csum, csum_add((__force __wsum) saddr, (__force __wsum) daddr)));
+        udp->check = csum_tcpudp_magic(saddr, daddr, udp_len, IPPROTO_UDP, csum);
+    } else {
+        saddr6 = header6->daddr;
+        daddr6 = header6->saddr;
+        memcpy(header6, &blob->ipv6, sizeof(struct ipv6hdr));
+        header6->saddr = saddr6;
+        header6->daddr = daddr6;
+        udp->check = csum_ipv6_magic(&saddr6, &daddr6, udp_len, IPPROTO_UDP, csum);
+    }
+    if(udp->check == 0) { udp->check = CSUM_MANGLED_0; }
+}
@@ -0,0 +1,107 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#pragma once
+
+#define CANNED_SIZE 65507
+#define CANNED_PAGES ((CANNED_SIZE + PAGE_SIZE - 1) / PAGE_SIZE)
+#define CANNED_PORTS 65536
+#define CANNED_LINE_SIZE 512
+#define CANNED_TTL 64
+
+/**
+ * Structure that defines the (immutable) payload of the canned
+ * responses, kept in pages that are attached (by reference) to
+ * the responses, together with the templates of the headers and
+ * their precomputed (partial) checksums.
+ */
+struct canned_blob {
+    unsigned int size;
+    unsigned int count;
+    struct iphdr ipv4;
+    struct ipv6hdr ipv6;
+    __wsum ipv4_csum;
+    __wsum udp_csum;
+    struct page *pages[CANNED_PAGES];
+};
+
+/**
+ * Structure that defines an instance of the responder (eg: for
+ * a network namespace) with its own (replaceable) payload and
+ * the set (bitmap) of the udp ports that it answers for.
+ */
+struct canned_context {
+    struct canned_blob __rcu *blob;
+    unsigned long *ports;
+    struct dentry *file;
+    struct dentry *ports_file;
+};
+
+/**
+ * Initializes the provided instance of the responder (with no
+ * payload nor ports) and creates the debugfs files through which
+ * the payload and the ports of the instance are loaded.
+ *
+ * @param context The instance of the responder to initialize.
+ * @param root The debugfs directory to create the files in.
+ * @return The result of the initialization, zero in case of
+ * success and a negative error code otherwise.
+ */
+int canned_init_c(struct canned_context *context, struct dentry *root);
+
+/**
+ * Removes the debugfs files of the instance and releases its
+ * payload (the pages referenced by responses remain valid).
+ *
+ * @param context The instance of the responder to release.
+ */
+void canned_destroy_c(struct canned_context *context);
+
+/**
+ * Checks if the provided IPv4 (without options) or IPv6 packet
+ * is an (unfragmented) udp datagram for one of the ports of the
+ * responder while a payload is loaded.
+ *
+ * @param context The instance of the responder.
+ * @param data The pointer to the start of the network header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @return The size of the network header of the packet in case it
+ * should be handled by the responder, zero otherwise.
+ */
+unsigned int canned_query_c(struct canned_context *context, unsigned char *data, unsigned int len);
+
+/**
+ * Rewrites (in place) the network and udp headers of the request
+ * into the ones of the response for the provided payload, from the
+ * templates and the precomputed checksums of the payload.
+ *
+ * @param blob The payload of the response (under rcu).
+ * @param data The pointer to the start of the network header.
+ * @param header_size The size of the network header (as returned
+ * by the query operation).
+ */
+void canned_reflect_c(struct canned_blob *blob, unsigned char *data, unsigned int header_size);
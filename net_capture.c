@@ -0,0 +1,170 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#include "common.h"
+
+#include "net_capture.h"
+
+/**
+ * Structure that defines the (kernel side) state of the
+ * capture ring of a cpu, the shared part is the header.
+ */
+struct capture_ring {
+    struct capture_header *header;
+    unsigned long size;
+    u32 sample;
+};
+
+static DEFINE_PER_CPU(struct capture_ring, capture_rings);
+
+static int capture_mmap_c(struct file *file, struct vm_area_struct *vma) {
+    struct capture_ring *ring = file->private_data;
+
+    /* the mapping must be read only as the contents of the
+    ring are only meant to be written by the producer, it may
+    not be made writable later either (mprotect) */
+    if(vma->vm_flags & VM_WRITE) { return -EPERM; }
+    vma->vm_flags &= ~VM_MAYWRITE;
+    return remap_vmalloc_range(vma, ring->header, vma->vm_pgoff);
+}
+
+static const struct file_operations capture_fops = {
+    .owner = THIS_MODULE,
+    .open = simple_open,
+    .mmap = capture_mmap_c,
+};
+
+int capture_init_c(struct dentry *root, unsigned int slots, unsigned int snap_len) {
+    struct capture_ring *ring;
+    struct capture_header *header;
+    struct dentry *directory;
+    char name[16];
+    unsigned int slot_size;
+    int cpu;
+
+    /* in case no slots are requested the capture is disabled
+    and no memory is allocated for the rings */
+    if(slots == 0) { return 0; }
+
+    /* calculates the size of each slot (aligned to the cache
+    line size) so that records never share cache lines */
+    slot_size = ALIGN(sizeof(struct capture_record) + snap_len, CAPTURE_HEADER_SIZE);
+
+    for_each_possible_cpu(cpu) {
+        ring = per_cpu_ptr(&capture_rings, cpu);
+        ring->size = PAGE_ALIGN(CAPTURE_HEADER_SIZE + (unsigned long) slots * slot_size);
+        ring->header = vmalloc_user(ring->size);
+        if(ring->header == NULL) { capture_destroy_c(); return -ENOMEM; }
+
+        header = ring->header;
+        header->magic = CAPTURE_MAGIC;
+        header->version = CAPTURE_VERSION;
+        header->slot_size = slot_size;
+        header->slot_count = slots;
+        header->snap_len = snap_len;
+        header->cpu = cpu;
+    }
+
+    /* creates the files through which the rings are mapped,
+    only after all of the rings have been allocated, a failure
+    in the creation is not fatal (no consumer is possible) */
+    directory = debugfs_create_dir("capture", root);
+    if(IS_ERR_OR_NULL(directory)) { return 0; }
+
+    for_each_possible_cpu(cpu) {
+        ring = per_cpu_ptr(&capture_rings, cpu);
+        snprintf(name, sizeof(name), "cpu%d", cpu);
+        debugfs_create_file(name, 0400, directory, ring, &capture_fops);
+    }
+
+    return 0;
+}
+
+void capture_destroy_c(void) {
+    struct capture_ring *ring;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        ring = per_cpu_ptr(&capture_rings, cpu);
+        vfree(ring->header);
+        ring->header = NULL;
+    }
+}
+
+struct capture_record *capture_begin_c(struct sk_buff *skb, u32 rate) {
+    struct capture_ring *ring = this_cpu_ptr(&capture_rings);
+    struct capture_header *header = ring->header;
+    struct capture_record *record;
+    unsigned int slot;
+    u64 sequence;
+
+    /* verifies that the capture is enabled and that the frame
+    is part of the sample, the counter is per cpu so no state
+    is shared between the producers */
+    if(rate == 0 || header == NULL) { return NULL; }
+    if(++ring->sample < rate) { return NULL; }
+    ring->sample = 0;
+
+    /* retrieves the slot for the next sequence, marks it as pending
+    before any of its contents are changed and reserves it (moving
+    the head) so that a nested record (eg: a mirrored frame that is
+    transmitted by the device on the same cpu) takes the next slot */
+    sequence = header->head;
+    div_u64_rem(sequence, header->slot_count, &slot);
+    record = (struct capture_record *) ((unsigned char *) header +
+        CAPTURE_HEADER_SIZE + slot * header->slot_size);
+    ACCESS_ONCE(record->sequence) = (sequence + 1) | CAPTURE_PENDING;
+    smp_wmb();
+    ACCESS_ONCE(header->head) = sequence + 1;
+
+    /* fills the metadata of the record and copies the start of
+    the frame (headers) from either the linear part or the
+    fragments of the frame, no linearization is required */
+    record->timestamp = ktime_to_ns(ktime_get_real());
+    record->ifindex = skb->dev->ifindex;
+    record->len = skb->len;
+    record->caplen = min_t(unsigned int, skb->len, header->snap_len);
+    record->cpu = smp_processor_id();
+    record->responder = 0;
+    record->verdict = CAPTURE_VERDICT_PASSED;
+    if(skb_copy_bits(skb, 0, record->data, record->caplen)) { record->caplen = 0; }
+
+    return record;
+}
+
+void capture_end_c(struct capture_record *record, u8 responder, u8 verdict) {
+    if(record == NULL) { return; }
+
+    record->responder = responder;
+    record->verdict = verdict;
+
+    /* publishes the record clearing the pending bit of its (reserved)
+    sequence, the barrier ensures that the consumers never see a
+    partially written record as complete */
+    smp_wmb();
+    ACCESS_ONCE(record->sequence) = record->sequence & ~CAPTURE_PENDING;
+}
@@ -0,0 +1,125 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#pragma once
+
+#define CAPTURE_MAGIC 0x44434150
+#define CAPTURE_VERSION 2
+#define CAPTURE_HEADER_SIZE 64
+#define CAPTURE_PENDING (1ULL << 63)
+
+#define CAPTURE_VERDICT_PASSED 0
+#define CAPTURE_VERDICT_REFLECTED 1
+#define CAPTURE_VERDICT_DROPPED 2
+#define CAPTURE_VERDICT_CONSUMED 3
+#define CAPTURE_VERDICT_FORWARDED 4
+
+/**
+ * Structure that defines the header of a capture ring, placed
+ * at the start of the memory mapped region of the ring (shared
+ * with userspace), the records follow the header.
+ *
+ * The head value is the number of records reserved so far (some
+ * of them may still be pending), the record of a sequence is at
+ * the slot (sequence % slot_count).
+ */
+struct capture_header {
+    __u32 magic;
+    __u32 version;
+    __u32 slot_size;
+    __u32 slot_count;
+    __u32 snap_len;
+    __u32 cpu;
+    __u64 head;
+};
+
+/**
+ * Structure that defines a record of the capture ring, the
+ * sequence value is the sequence number plus one with the pending
+ * bit set while the record is being written and without it once
+ * it's complete, so that a consumer is able to wait for pending
+ * records and to detect overwritten ones.
+ */
+struct capture_record {
+    __u64 sequence;
+    __u64 timestamp;
+    __u32 ifindex;
+    __u32 len;
+    __u16 caplen;
+    __u16 cpu;
+    __u8 responder;
+    __u8 verdict;
+    __u8 reserved[2];
+    __u8 data[0];
+};
+
+/**
+ * Allocates the per cpu capture rings and creates the
+ * debugfs files through which they're memory mapped.
+ *
+ * @param root The debugfs directory to create the files in.
+ * @param slots The number of records of each of the rings.
+ * @param snap_len The maximum number of bytes of each frame.
+ * @return The result of the initialization, zero in case of
+ * success and a negative error code otherwise.
+ */
+int capture_init_c(struct dentry *root, unsigned int slots, unsigned int snap_len);
+
+/**
+ * Releases the per cpu capture rings, should be called
+ * only after the debugfs files have been removed.
+ */
+void capture_destroy_c(void);
+
+/**
+ * Starts a new record in the ring of the current cpu for the
+ * provided frame, copying its (truncated) contents, the frame
+ * data is expected to start at the mac header.
+ *
+ * The slot of the record is reserved at once (head moved) so
+ * that records may be nested (eg: a frame transmitted while
+ * another one is being processed on the same cpu).
+ *
+ * Must be called with bottom halves disabled (single producer).
+ *
+ * @param skb The frame to be recorded.
+ * @param rate The sampling rate, one frame of each rate frames
+ * is recorded (zero disables the recording).
+ * @return The record that was started or NULL in case the frame
+ * is not sampled (or capture is disabled).
+ */
+struct capture_record *capture_begin_c(struct sk_buff *skb, u32 rate);
+
+/**
+ * Completes the provided record, setting the responder and the
+ * verdict of the frame and publishing it to the consumers.
+ *
+ * @param record The record to be completed, may be NULL.
+ * @param responder The identifier of the responder of the frame.
+ * @param verdict The verdict of the processing of the frame.
+ */
+void capture_end_c(struct capture_record *record, u8 responder, u8 verdict);
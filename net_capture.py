@@ -0,0 +1,175 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Hive Drivers
+# Copyright (c) 2008-2015 Hive Solutions Lda.
+#
+# This file is part of Hive Drivers.
+#
+# Hive Drivers is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Hive Drivers is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+__author__ = "João Magalhães <joamag@hive.pt>"
+""" The author(s) of the module """
+
+__version__ = "1.0.0"
+""" The version of the module """
+
+__revision__ = "$LastChangedRevision$"
+""" The revision number of the module """
+
+__date__ = "$LastChangedDate$"
+""" The last change date of the module """
+
+__copyright__ = "Copyright (c) 2008-2015 Hive Solutions Lda."
+""" The copyright for the module """
+
+__license__ = "GNU General Public License (GPL), Version 3"
+""" The license for the module """
+
+import os
+import sys
+import mmap
+import time
+import glob
+import struct
+
+CAPTURE_PATH = "/sys/kernel/debug/net_dummy/capture"
+""" The path to the debugfs directory that contains the
+memory mapped files of the per cpu capture rings """
+
+CAPTURE_MAGIC = 0x44434150
+""" The magic value that identifies a valid capture ring """
+
+CAPTURE_PENDING = 1 << 63
+""" The bit of the sequence of a record that is set while
+the record is still being written by the producer """
+
+HEADER_FORMAT = "=IIIIIIQ"
+""" The format of the header of a capture ring, must
+be kept in sync with the capture_header structure """
+
+RECORD_FORMAT = "=QQIIHHBB2x"
+""" The format of the (metadata of a) record of a capture
+ring, must be kept in sync with the capture_record structure """
+
+HEADER_SIZE = 64
+""" The size of the header of a capture ring, the first
+record starts at this offset """
+
+RESPONDERS = ("none", "arp", "ip", "ipv6", "multicast", "custom", "dns", "canned")
+""" The names of the responders of the device, indexed
+by the identifier of the responder """
+
+VERDICTS = ("passed", "reflected", "dropped", "consumed", "forwarded")
+""" The names of the verdicts of the device, indexed
+by the identifier of the verdict """
+
+class Ring(object):
+
+    def __init__(self, path):
+        self.path = path
+        self.file = open(path, "rb")
+        size = os.fstat(self.file.fileno()).st_size or mmap.PAGESIZE
+        self.map = mmap.mmap(self.file.fileno(), size, mmap.MAP_SHARED, mmap.PROT_READ)
+        header = struct.unpack_from(HEADER_FORMAT, self.map, 0)
+        magic, _version, self.slot_size, self.slot_count, self.snap_len, self.cpu, head = header
+        if not magic == CAPTURE_MAGIC: raise RuntimeError("Invalid capture ring '%s'" % path)
+        self.remap()
+        self.tail = head
+        self.lost = 0
+
+    def remap(self):
+        # re-maps the ring with the complete size (header and all
+        # of the slots) as the debugfs file has no size information
+        size = HEADER_SIZE + self.slot_size * self.slot_count
+        size = (size + mmap.PAGESIZE - 1) // mmap.PAGESIZE * mmap.PAGESIZE
+        self.map.close()
+        self.map = mmap.mmap(self.file.fileno(), size, mmap.MAP_SHARED, mmap.PROT_READ)
+
+    def head(self):
+        return struct.unpack_from("=Q", self.map, 24)[0]
+
+    def poll(self):
+        records = []
+        head = self.head()
+
+        # in case the producer has lapped the consumer the records
+        # in between are lost and the tail is moved forward
+        if head - self.tail > self.slot_count:
+            self.lost += head - self.tail - self.slot_count
+            self.tail = head - self.slot_count
+
+        while self.tail < head:
+            offset = HEADER_SIZE + (self.tail % self.slot_count) * self.slot_size
+            record = struct.unpack_from(RECORD_FORMAT, self.map, offset)
+            start = offset + struct.calcsize(RECORD_FORMAT)
+            data = self.map[start:start + record[4]]
+
+            # in case the record is still being written (reserved
+            # but pending) it's retried on the next poll
+            if record[0] == (self.tail + 1) | CAPTURE_PENDING: break
+
+            # verifies that the record was not overwritten while
+            # being copied (sequence is changed by the producer)
+            sequence = struct.unpack_from("=Q", self.map, offset)[0]
+            if not sequence == self.tail + 1 or not record[0] == self.tail + 1: self.lost += 1
+            else: records.append((record, data))
+            self.tail += 1
+
+        return records
+
+def write_header(file, snap_len):
+    file.write(struct.pack("=IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, snap_len, 1))
+
+def write_record(file, record, data):
+    _sequence, timestamp, _ifindex, length, caplen, _cpu, _responder, _verdict = record
+    seconds, nanos = divmod(timestamp, 1000000000)
+    file.write(struct.pack("=IIII", seconds, nanos // 1000, caplen, length))
+    file.write(data)
+
+def main():
+    # retrieves the target file for the pcap output, by default
+    # the standard output is used (eg: piping into tcpdump -r -)
+    target = sys.argv[1] if len(sys.argv) > 1 else None
+    output = open(target, "wb") if target else getattr(sys.stdout, "buffer", sys.stdout)
+
+    paths = sorted(glob.glob(os.path.join(CAPTURE_PATH, "cpu*")))
+    rings = [Ring(path) for path in paths]
+    if not rings: raise RuntimeError("No capture rings found in '%s'" % CAPTURE_PATH)
+
+    write_header(output, max(ring.snap_len for ring in rings))
+
+    try:
+        while True:
+            # polls all of the rings merging the records by their
+            # timestamp so that the output is (mostly) ordered
+            records = []
+            for ring in rings: records.extend(ring.poll())
+            records.sort(key = lambda item: item[0][1])
+            for record, data in records:
+                write_record(output, record, data)
+                sys.stderr.write(
+                    "cpu%d if%d %s %s %d bytes\n" % (
+                        record[5], record[2], RESPONDERS[record[6]] if record[6] < len(RESPONDERS) else record[6],
+                        VERDICTS[record[7]] if record[7] < len(VERDICTS) else record[7], record[3]
+                    )
+                )
+            output.flush()
+            if not records: time.sleep(0.01)
+    except KeyboardInterrupt:
+        lost = sum(ring.lost for ring in rings)
+        sys.stderr.write("%d records lost\n" % lost)
+
+if __name__ == "__main__":
+    main()
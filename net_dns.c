@@ -0,0 +1,512 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#include "common.h"
+
+#include "net_proto.h"
+#include "net_dns.h"
+
+/**
+ * Structure that defines the state of the loading of a new
+ * table, the entries are parsed line by line as written and
+ * the table is only built (and published) once it's closed.
+ */
+struct dns_builder {
+    struct dns_context *context;
+    bool loading;
+    char line[DNS_LINE_SIZE];
+    unsigned int line_len;
+    struct dns_entry *entries;
+    unsigned int count;
+    u32 ttl;
+    int error;
+};
+
+static DEFINE_MUTEX(dns_mutex);
+static u32 dns_seed;
+
+static inline u32 dns_hash_c(const u8 *name, unsigned int name_len, u8 wildcard) {
+    return jhash(name, name_len, dns_seed ^ wildcard);
+}
+
+static struct dns_entry *dns_lookup_c(struct dns_table *table, const u8 *name, unsigned int name_len, u8 wildcard) {
+    struct dns_entry *entry;
+    u32 hash = dns_hash_c(name, name_len, wildcard);
+
+    for(entry = table->buckets[hash & table->mask]; entry != NULL; entry = entry->next) {
+        if(entry->hash != hash || entry->wildcard != wildcard) { continue; }
+        if(entry->name_len != name_len) { continue; }
+        if(memcmp(entry->name, name, name_len)) { continue; }
+        return entry;
+    }
+
+    return NULL;
+}
+
+static struct dns_entry *dns_resolve_c(struct dns_table *table, const u8 *name, unsigned int name_len) {
+    struct dns_entry *entry;
+    unsigned int offset = 0;
+
+    /* tries the exact name first and then the wildcard zones that
+    contain it, from the closest to the farthest one (the name
+    is stripped one label at a time) */
+    entry = dns_lookup_c(table, name, name_len, 0);
+    while(entry == NULL && name[offset] != 0) {
+        offset += name[offset] + 1;
+        entry = dns_lookup_c(table, &(name[offset]), name_len - offset, 1);
+    }
+
+    return entry;
+}
+
+static void dns_free_c(struct dns_entry *entries) {
+    struct dns_entry *entry;
+
+    while(entries != NULL) {
+        entry = entries;
+        entries = entry->next;
+        kfree(entry);
+    }
+}
+
+static void dns_table_free_c(struct dns_table *table) {
+    unsigned int index;
+
+    if(table == NULL) { return; }
+    for(index = 0; index <= table->mask; index++) { dns_free_c(table->buckets[index]); }
+    vfree(table);
+}
+
+static int dns_name_c(char *text, u8 *name, u8 *wildcard) {
+    unsigned int name_len = 0;
+    unsigned int label_len;
+    char *label;
+
+    /* a leading wildcard label turns the entry into a zone that
+    answers for any name under it (but not for the zone itself) */
+    *wildcard = 0;
+    if(text[0] == '*' && text[1] == '.') { *wildcard = 1; text += 2; }
+
+    /* converts the (dotted) name into the wire format, the final
+    dot is optional and the labels are kept in lower case */
+    while((label = strsep(&text, ".")) != NULL) {
+        label_len = strlen(label);
+        if(label_len == 0) {
+            if(text != NULL && *text != '\0') { return -EINVAL; }
+            break;
+        }
+        if(label_len > DNS_LABEL_SIZE) { return -EINVAL; }
+        if(name_len + label_len + 2 > DNS_NAME_SIZE) { return -EINVAL; }
+        name[name_len++] = label_len;
+        while(*label != '\0') { name[name_len++] = tolower(*label++); }
+    }
+
+    name[name_len++] = 0;
+    return name_len;
+}
+
+static int dns_parse_c(struct dns_builder *builder, char *line) {
+    struct dns_entry *entry;
+    u8 name[DNS_NAME_SIZE];
+    char *token;
+    int name_len;
+    u8 wildcard;
+
+    /* skips the empty lines and the comments, the ttl directive
+    sets the ttl of the answers (for the complete table) */
+    line = strim(line);
+    if(line[0] == '\0' || line[0] == '#') { return 0; }
+    token = strsep(&line, " \t");
+    if(!strcmp(token, "$TTL")) {
+        if(line == NULL) { return -EINVAL; }
+        return kstrtou32(skip_spaces(line), 10, &builder->ttl);
+    }
+
+    name_len = dns_name_c(token, name, &wildcard);
+    if(name_len < 0) { return name_len; }
+
+    entry = kzalloc(sizeof(struct dns_entry) + name_len, GFP_KERNEL);
+    if(entry == NULL) { return -ENOMEM; }
+    entry->wildcard = wildcard;
+    entry->name_len = name_len;
+    memcpy(entry->name, name, name_len);
+
+    /* parses the addresses of the name, at most one of each
+    family (the last one is used) is kept for the answers */
+    while((token = strsep(&line, " \t")) != NULL) {
+        if(token[0] == '\0') { continue; }
+        if(in4_pton(token, -1, (u8 *) &entry->a, -1, NULL)) {
+            entry->flags |= DNS_ENTRY_A;
+        } else if(in6_pton(token, -1, entry->aaaa.s6_addr, -1, NULL)) {
+            entry->flags |= DNS_ENTRY_AAAA;
+        } else {
+            kfree(entry);
+            return -EINVAL;
+        }
+    }
+
+    entry->next = builder->entries;
+    builder->entries = entry;
+    builder->count++;
+    return 0;
+}
+
+static struct dns_table *dns_build_c(struct dns_builder *builder) {
+    struct dns_table *table;
+    struct dns_entry *entry;
+    struct dns_entry *existing;
+    unsigned int buckets = roundup_pow_of_two(max(builder->count, 1u));
+
+    table = vzalloc(sizeof(struct dns_table) + buckets * sizeof(struct dns_entry *));
+    if(table == NULL) { return NULL; }
+    table->ttl = builder->ttl;
+    table->mask = buckets - 1;
+
+    /* moves the entries into the buckets (one entry per bucket on
+    average), the addresses of the entries for the same name are
+    merged, the entries were parsed in reverse order so the ones
+    from the later lines take precedence */
+    while(builder->entries != NULL) {
+        entry = builder->entries;
+        builder->entries = entry->next;
+        existing = dns_lookup_c(table, entry->name, entry->name_len, entry->wildcard);
+        if(existing != NULL) {
+            if(!(existing->flags & DNS_ENTRY_A)) { existing->a = entry->a; }
+            if(!(existing->flags & DNS_ENTRY_AAAA)) { existing->aaaa = entry->aaaa; }
+            existing->flags |= entry->flags;
+            kfree(entry);
+            continue;
+        }
+        entry->hash = dns_hash_c(entry->name, entry->name_len, entry->wildcard);
+        entry->next = table->buckets[entry->hash & table->mask];
+        table->buckets[entry->hash & table->mask] = entry;
+        table->count++;
+    }
+
+    return table;
+}
+
+static int dns_show_c(struct seq_file *file, void *data) {
+    struct dns_builder *builder = file->private;
+    struct dns_table *table;
+
+    mutex_lock(&dns_mutex);
+    table = rcu_dereference_protected(builder->context->table, lockdep_is_held(&dns_mutex));
+    if(table != NULL) {
+        seq_printf(file, "entries %u\nbuckets %u\nttl %u\n", table->count, table->mask + 1, table->ttl);
+    }
+    mutex_unlock(&dns_mutex);
+    return 0;
+}
+
+static int dns_open_c(struct inode *inode, struct file *file) {
+    struct dns_builder *builder;
+    int error;
+
+    /* opening the file for writing starts the loading of a new
+    table, that replaces the current one once the file is closed */
+    builder = kzalloc(sizeof(struct dns_builder), GFP_KERNEL);
+    if(builder == NULL) { return -ENOMEM; }
+    builder->context = inode->i_private;
+    builder->loading = file->f_mode & FMODE_WRITE ? true : false;
+    builder->ttl = DNS_TTL;
+
+    error = single_open(file, dns_show_c, builder);
+    if(error) { kfree(builder); }
+    return error;
+}
+
+static ssize_t dns_write_c(struct file *file, const char __user *buffer, size_t count, loff_t *position) {
+    struct dns_builder *builder = ((struct seq_file *) file->private_data)->private;
+    char chunk[128];
+    size_t offset = 0;
+    size_t size;
+    size_t index;
+    int error;
+
+    if(builder->error) { return builder->error; }
+
+    /* accumulates the written data into lines, each of the lines
+    is parsed (into an entry) as soon as it's complete */
+    while(offset < count) {
+        size = min(count - offset, sizeof(chunk));
+        if(copy_from_user(chunk, buffer + offset, size)) { return -EFAULT; }
+        for(index = 0; index < size; index++) {
+            if(chunk[index] != '\n') {
+                if(builder->line_len == DNS_LINE_SIZE - 1) { builder->error = -EINVAL; return -EINVAL; }
+                builder->line[builder->line_len++] = chunk[index];
+                continue;
+            }
+            builder->line[builder->line_len] = '\0';
+            builder->line_len = 0;
+            error = dns_parse_c(builder, builder->line);
+            if(error) { builder->error = error; return error; }
+        }
+        offset += size;
+    }
+
+    return count;
+}
+
+static int dns_release_c(struct inode *inode, struct file *file) {
+    struct dns_builder *builder = ((struct seq_file *) file->private_data)->private;
+    struct dns_table *previous;
+    struct dns_table *table = NULL;
+
+    if(!builder->loading) {
+        kfree(builder);
+        return single_release(inode, file);
+    }
+
+    /* parses the last line (with no line break) and builds the
+    new table, an empty table removes the current one */
+    if(!builder->error && builder->line_len > 0) {
+        builder->line[builder->line_len] = '\0';
+        builder->error = dns_parse_c(builder, builder->line);
+    }
+    if(!builder->error && builder->count > 0) {
+        table = dns_build_c(builder);
+        if(table == NULL) { builder->error = -ENOMEM; }
+    }
+
+    /* replaces the table atomically, the previous one is only
+    released after the grace period of the responders using it */
+    if(!builder->error) {
+        mutex_lock(&dns_mutex);
+        previous = rcu_dereference_protected(builder->context->table, lockdep_is_held(&dns_mutex));
+        rcu_assign_pointer(builder->context->table, table);
+        mutex_unlock(&dns_mutex);
+        synchronize_rcu();
+        dns_table_free_c(previous);
+    }
+
+    dns_free_c(builder->entries);
+    kfree(builder);
+    return single_release(inode, file);
+}
+
+static const struct file_operations dns_fops = {
+    .owner = THIS_MODULE,
+    .open = dns_open_c,
+    .read = seq_read,
+    .write = dns_write_c,
+    .llseek = seq_lseek,
+    .release = dns_release_c,
+};
+
+int dns_init_c(struct dns_context *context, struct dentry *root) {
+    /* the seed of the hash is shared by all of the instances
+    and is only generated once (for the first instance) */
+    net_get_random_once(&dns_seed, sizeof(dns_seed));
+
+    RCU_INIT_POINTER(context->table, NULL);
+    context->file = NULL;
+    if(root != NULL) { context->file = debugfs_create_file("dns", 0600, root, context, &dns_fops); }
+    return 0;
+}
+
+void dns_destroy_c(struct dns_context *context) {
+    debugfs_remove(context->file);
+    context->file = NULL;
+    dns_table_free_c(rcu_dereference_protected(context->table, 1));
+    RCU_INIT_POINTER(context->table, NULL);
+}
+
+static unsigned int dns_transport_c(unsigned char *data, unsigned int len) {
+    struct iphdr *header = (struct iphdr *) data;
+    struct ipv6hdr *header6 = (struct ipv6hdr *) data;
+    unsigned int header_size;
+
+    /* retrieves the size of the network header of the packet in
+    case it's an (unfragmented) udp datagram, zero otherwise */
+    if(len < sizeof(struct iphdr)) { return 0; }
+    switch(header->version) {
+        case 4:
+            header_size = header->ihl * 4;
+            if(header_size < sizeof(struct iphdr)) { return 0; }
+            if(header->protocol != IPPROTO_UDP) { return 0; }
+            if(header->frag_off & htons(IP_MF | IP_OFFSET)) { return 0; }
+            if(ipv4_is_multicast(header->daddr) || ipv4_is_lbcast(header->daddr)) { return 0; }
+            break;
+
+        case 6:
+            header_size = sizeof(struct ipv6hdr);
+            if(len < header_size) { return 0; }
+            if(header6->nexthdr != IPPROTO_UDP) { return 0; }
+            if(ipv6_addr_is_multicast(&header6->daddr)) { return 0; }
+            break;
+
+        default:
+            return 0;
+    }
+
+    if(len < header_size + sizeof(struct udphdr)) { return 0; }
+    return header_size;
+}
+
+bool dns_query_c(struct dns_context *context, unsigned char *data, unsigned int len) {
+    struct udphdr *udp;
+    unsigned int header_size;
+
+    if(rcu_access_pointer(context->table) == NULL) { return false; }
+    header_size = dns_transport_c(data, len);
+    if(header_size == 0) { return false; }
+    udp = (struct udphdr *) &(data[header_size]);
+    return udp->dest == htons(DNS_PORT);
+}
+
+unsigned int dns_reflect_c(struct dns_context *context, unsigned char *data, unsigned int len, unsigned int size) {
+    struct iphdr *header = (struct iphdr *) data;
+    struct ipv6hdr *header6 = (struct ipv6hdr *) data;
+    struct dns_table *table;
+    struct dns_entry *entry;
+    struct udphdr *udp;
+    unsigned char *message;
+    unsigned char *answer;
+    u8 name[DNS_NAME_SIZE];
+    unsigned int header_size;
+    unsigned int message_len;
+    unsigned int offset;
+    unsigned int name_len = 0;
+    unsigned int label_len;
+    unsigned int answer_len = 0;
+    unsigned int udp_len;
+    u16 flags;
+    u16 type;
+    u16 rcode = 0;
+    __be16 port;
+    __be32 address;
+    struct in6_addr address6;
+    __wsum csum;
+
+    /* retrieves the transport header and the dns message, using
+    the length from the headers (the frame may be padded) */
+    header_size = dns_transport_c(data, len);
+    if(header_size == 0) { return 0; }
+    if(header->version == 4) {
+        if(ntohs(header->tot_len) > len) { return 0; }
+        len = ntohs(header->tot_len);
+    } else {
+        if(header_size + ntohs(header6->payload_len) > len) { return 0; }
+        len = header_size + ntohs(header6->payload_len);
+    }
+    udp = (struct udphdr *) &(data[header_size]);
+    if(ntohs(udp->len) < sizeof(struct udphdr) + DNS_HEADER_SIZE) { return 0; }
+    if(header_size + ntohs(udp->len) > len) { return 0; }
+    message = &(data[header_size + sizeof(struct udphdr)]);
+    message_len = ntohs(udp->len) - sizeof(struct udphdr);
+
+    /* only (standard) queries with a single question are answered,
+    responses are never answered (avoiding loops) */
+    flags = get_unaligned_be16(&(message[2]));
+    if(flags & (DNS_FLAG_QR | DNS_FLAG_OPCODE)) { return 0; }
+    if(get_unaligned_be16(&(message[4])) != 1) { return 0; }
+
+    /* converts the name of the question into the (lower case)
+    key of the table, compressed names are not valid in queries */
+    offset = DNS_HEADER_SIZE;
+    while(true) {
+        if(offset >= message_len) { return 0; }
+        label_len = message[offset];
+        if(label_len > DNS_LABEL_SIZE) { return 0; }
+        if(offset + label_len + 1 > message_len) { return 0; }
+        if(name_len + label_len + 1 > DNS_NAME_SIZE) { return 0; }
+        name[name_len++] = label_len;
+        offset++;
+        if(label_len == 0) { break; }
+        while(label_len-- > 0) { name[name_len++] = tolower(message[offset++]); }
+    }
+    if(offset + 4 > message_len) { return 0; }
+    type = get_unaligned_be16(&(message[offset]));
+    if(get_unaligned_be16(&(message[offset + 2])) != DNS_CLASS_IN) { return 0; }
+    offset += 4;
+
+    /* verifies that there's room for the largest answer before
+    any change is done, the extra records are discarded */
+    if(header_size + sizeof(struct udphdr) + offset + DNS_ANSWER_SIZE > size) { return 0; }
+
+    /* resolves the name and builds the answer (after the question)
+    referencing the name of the question (compression pointer) */
+    answer = &(message[offset]);
+    rcu_read_lock();
+    table = rcu_dereference(context->table);
+    entry = table ? dns_resolve_c(table, name, name_len) : NULL;
+    if(entry == NULL) {
+        rcode = DNS_RCODE_NXDOMAIN;
+    } else if(type == DNS_TYPE_A && entry->flags & DNS_ENTRY_A) {
+        answer_len = 16;
+        put_unaligned_be16(4, &(answer[10]));
+        memcpy(&(answer[12]), &entry->a, 4);
+    } else if(type == DNS_TYPE_AAAA && entry->flags & DNS_ENTRY_AAAA) {
+        answer_len = 28;
+        put_unaligned_be16(16, &(answer[10]));
+        memcpy(&(answer[12]), &entry->aaaa, 16);
+    }
+    if(answer_len > 0) {
+        put_unaligned_be16(0xc000 | DNS_HEADER_SIZE, &(answer[0]));
+        put_unaligned_be16(type, &(answer[2]));
+        put_unaligned_be16(DNS_CLASS_IN, &(answer[4]));
+        put_unaligned_be32(table->ttl, &(answer[6]));
+    }
+    rcu_read_unlock();
+
+    /* turns the query into an (authoritative) response, keeping
+    the recursion desired flag as required by the specification */
+    put_unaligned_be16(DNS_FLAG_QR | DNS_FLAG_AA | (flags & DNS_FLAG_RD) | rcode, &(message[2]));
+    put_unaligned_be16(answer_len ? 1 : 0, &(message[6]));
+    put_unaligned_be16(0, &(message[8]));
+    put_unaligned_be16(0, &(message[10]));
+    message_len = offset + answer_len;
+
+    /* switches the ports and the addresses and updates the lengths,
+    the checksums are computed as the size of the message changed */
+    udp_len = sizeof(struct udphdr) + message_len;
+    port = udp->source;
+    udp->source = udp->dest;
+    udp->dest = port;
+    udp->len = htons(udp_len);
+    udp->check = 0;
+    csum = csum_partial(udp, udp_len, 0);
+
+    if(header->version == 4) {
+        address = header->saddr;
+        header->saddr = header->daddr;
+        header->daddr = address;
+        header->tot_len = htons(header_size + udp_len);
+        ip_send_check(header);
+        udp->check = csum_tcpudp_magic(header->saddr, header->daddr, udp_len, IPPROTO_UDP, csum);
+    } else {
+        address6 = header6->saddr;
+        header6->saddr = header6->daddr;
+        header6->daddr = address6;
+        header6->payload_len = htons(udp_len);
+        udp->check = csum_ipv6_magic(&header6->saddr, &header6->daddr, udp_len, IPPROTO_UDP, csum);
+    }
+    if(udp->check == 0) { udp->check = CSUM_MANGLED_0; }
+
+    return header_size + udp_len;
+}
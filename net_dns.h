@@ -0,0 +1,134 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#pragma once
+
+#define DNS_PORT 53
+#define DNS_HEADER_SIZE 12
+#define DNS_NAME_SIZE 255
+#define DNS_LABEL_SIZE 63
+#define DNS_LINE_SIZE 512
+#define DNS_ANSWER_SIZE 28
+#define DNS_TTL 60
+
+#define DNS_FLAG_QR 0x8000
+#define DNS_FLAG_OPCODE 0x7800
+#define DNS_FLAG_AA 0x0400
+#define DNS_FLAG_RD 0x0100
+#define DNS_RCODE_NXDOMAIN 3
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_AAAA 28
+#define DNS_CLASS_IN 1
+
+#define DNS_ENTRY_A 0x01
+#define DNS_ENTRY_AAAA 0x02
+
+/**
+ * Structure that defines an entry (name) of the table of the
+ * responder, the name is kept in (lower case) wire format and
+ * for wildcard entries it's the zone (without the wildcard).
+ */
+struct dns_entry {
+    struct dns_entry *next;
+    u32 hash;
+    u8 wildcard;
+    u8 flags;
+    u8 name_len;
+    __be32 a;
+    struct in6_addr aaaa;
+    u8 name[0];
+};
+
+/**
+ * Structure that defines the (immutable) table of names of the
+ * responder, replaced as a whole (rcu) when a new one is loaded.
+ */
+struct dns_table {
+    u32 ttl;
+    unsigned int count;
+    unsigned int mask;
+    struct dns_entry *buckets[0];
+};
+
+/**
+ * Structure that defines an instance of the responder (eg: for
+ * a network namespace) with its own (replaceable) table of names.
+ */
+struct dns_context {
+    struct dns_table __rcu *table;
+    struct dentry *file;
+};
+
+/**
+ * Initializes the provided instance of the responder (with no
+ * table) and creates the debugfs file through which the table
+ * of names of the instance is loaded (replaced) and queried.
+ *
+ * @param context The instance of the responder to initialize.
+ * @param root The debugfs directory to create the file in.
+ * @return The result of the initialization, zero in case of
+ * success and a negative error code otherwise.
+ */
+int dns_init_c(struct dns_context *context, struct dentry *root);
+
+/**
+ * Removes the debugfs file of the instance and releases its
+ * table of names (if any).
+ *
+ * @param context The instance of the responder to release.
+ */
+void dns_destroy_c(struct dns_context *context);
+
+/**
+ * Checks if the provided IPv4 or IPv6 packet is an (unfragmented)
+ * udp datagram for the dns port while a table is loaded, only the
+ * network and transport headers are inspected.
+ *
+ * @param context The instance of the responder.
+ * @param data The pointer to the start of the network header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @return If the packet should be handled by the responder.
+ */
+bool dns_query_c(struct dns_context *context, unsigned char *data, unsigned int len);
+
+/**
+ * Rewrites (in place) the provided dns query into the response
+ * for it, answering A and AAAA questions from the loaded table,
+ * the answer is appended to the question (any extra record of the
+ * query is discarded) and the headers and checksums are updated.
+ *
+ * @param context The instance of the responder (with the table).
+ * @param data The pointer to the start of the network header, the
+ * complete packet must be in the buffer.
+ * @param len The number of bytes of the packet.
+ * @param size The number of bytes available for the response.
+ * @return The number of bytes of the response (from the network
+ * header) or zero in case the query is not answered, in which case
+ * the buffer is left untouched.
+ */
+unsigned int dns_reflect_c(struct dns_context *context, unsigned char *data, unsigned int len, unsigned int size);
@@ -27,6 +27,14 @@
 
 #include "common.h"
 
+#include "net_proto.h"
+#include "net_capture.h"
+#include "net_mcast.h"
+#include "net_sketch.h"
+#include "net_responder.h"
+#include "net_bench.h"
+#include "net_dns.h"
+#include "net_canned.h"
 #include "net_dummy.h"
 
 /**
@@ -38,23 +46,190 @@ struct pcpu_dstats {
     u64 tx_packets;
     u64 rx_bytes;
     u64 tx_bytes;
+    u64 events[DUMMY_EVENT_COUNT];
     struct u64_stats_sync syncp;
 };
 
+/**
+ * Structure that defines the compact (shared) statistics
+ * of a device, used when the per cpu statistics are not
+ * desired, the cost is constant and independent from the
+ * number of possible cpus in the system.
+ */
+struct dummy_cstats {
+    atomic64_t rx_packets;
+    atomic64_t tx_packets;
+    atomic64_t rx_bytes;
+    atomic64_t tx_bytes;
+    atomic64_t events[DUMMY_EVENT_COUNT];
+};
+
+/**
+ * Structure that defines the (private) control block of a
+ * reflected frame, the transmit queue and the number of bytes
+ * that are completed (byte queue limits) once it's received.
+ */
+struct dummy_skb_cb {
+    u32 bytes;
+    u16 queue;
+};
+
+#define DUMMY_SKB_CB(skb) ((struct dummy_skb_cb *) (skb)->cb)
+
+/**
+ * Structure that defines the completions (frames and bytes)
+ * accumulated by a receive queue for a transmit queue.
+ */
+struct dummy_tx_completion {
+    u32 frames;
+    u32 bytes;
+};
+
+/**
+ * Structure that defines a receive queue of the device,
+ * the reflected frames are queued in the input queue and
+ * received (through gro) in the context of the napi poll.
+ */
+struct dummy_rx_queue {
+    struct napi_struct napi;
+    struct sk_buff_head input;
+    struct sk_buff_head process;
+    struct call_single_data csd;
+    struct hrtimer timer;
+    atomic_t coalesced;
+    u32 usecs;
+    u32 frames;
+    u32 window_frames;
+    u64 window_start;
+    unsigned long state;
+    unsigned long *stopped;
+    unsigned long *completed;
+    struct dummy_tx_completion *completions;
+    unsigned int index;
+    int cpu;
+} ____cacheline_aligned_in_smp;
+
+/**
+ * Structure that defines the (per cpu) results of the
+ * benchmark of a device, only written by the thread of
+ * the cpu, per kind of frame injected.
+ */
+struct dummy_bench_stats {
+    u64 frames[BENCH_KINDS][DUMMY_RESPONDER_COUNT];
+    u64 ns[BENCH_KINDS][DUMMY_RESPONDER_COUNT];
+    u64 stopped;
+};
+
+/**
+ * Structure that defines the state of the benchmark of a
+ * device, the threads (one per online cpu) inject frames
+ * directly into the transmit path of the device.
+ */
+struct dummy_bench {
+    struct task_struct **threads;
+    struct dummy_bench_stats __percpu *stats;
+    u64 start;
+    u64 end;
+    bool running;
+};
+
+/**
+ * Structure that defines the (exported) statistics page of a
+ * device, published periodically (work) while it's open, the
+ * page outlives the device in case it's still open.
+ */
+struct dummy_stats_export {
+    struct dummy_stats_header *header;
+    unsigned long size;
+    struct delayed_work work;
+    struct net_device *dev;
+    unsigned int users;
+};
+
+/**
+ * Structure that defines the state of the driver in a network
+ * namespace, the debugfs directory of the namespace (under which
+ * the devices of the namespace are placed) and the configuration
+ * of the responders that is specific to the namespace.
+ */
+struct dummy_net {
+    struct dentry *debugfs;
+    struct dentry *stats;
+    struct dns_context dns;
+    struct canned_context canned;
+};
+
+/**
+ * The private structure associated with each of the
+ * devices, allocated together with the device structure
+ * and retrieved using the netdev_priv call.
+ */
+struct dummy_priv {
+    struct dummy_cstats cstats;
+    struct dummy_rx_queue *rx_queues;
+    struct dentry *debugfs;
+    u32 gro_flush_frames;
+    u32 capture_rate;
+    u32 rss_hash;
+    u32 rss_steer;
+    u32 fanout;
+    u32 sketch;
+    u32 rx_timestamp;
+    u32 bench_rate;
+    u32 bench_mask;
+    struct dummy_bench *bench;
+    struct mutex bench_mutex;
+    struct net_device __rcu *mirror;
+    u32 mirror_mode;
+    struct net_device __rcu *peer;
+    u32 peer_rewrite;
+    struct dummy_stats_export *stats_export;
+    u32 stats_usecs;
+    u32 mc_all;
+    struct mcast_filter __rcu *mc_filter;
+    struct ethtool_coalesce coalesce;
+    u8 rss_key[DUMMY_RSS_KEY_SIZE];
+    u16 rss_indir[DUMMY_RSS_INDIR_SIZE];
+};
+
 static const struct net_device_ops dummy_netdev_ops = {
     .ndo_init = dummy_dev_init,
     .ndo_uninit = dummy_dev_uninit,
+    .ndo_open = dummy_open,
+    .ndo_stop = dummy_stop,
     .ndo_start_xmit = dummy_xmit,
     .ndo_validate_addr = eth_validate_addr,
     .ndo_set_rx_mode = dummy_set_multicast,
     .ndo_set_mac_address = dummy_set_address,
+    .ndo_change_mtu = dummy_change_mtu,
     .ndo_get_stats64 = dummy_get_stats64,
+#ifdef CONFIG_NET_RX_BUSY_POLL
+    .ndo_busy_poll = dummy_busy_poll,
+#endif
+};
+
+static const struct ethtool_ops dummy_ethtool_ops = {
+    .get_link = ethtool_op_get_link,
+    .get_sset_count = dummy_get_sset_count,
+    .get_strings = dummy_get_strings,
+    .get_ethtool_stats = dummy_get_ethtool_stats,
+    .get_ts_info = ethtool_op_get_ts_info,
+    .get_coalesce = dummy_get_coalesce,
+    .set_coalesce = dummy_set_coalesce,
+    .get_rxnfc = dummy_get_rxnfc,
+    .get_rxfh_key_size = dummy_get_rxfh_key_size,
+    .get_rxfh_indir_size = dummy_get_rxfh_indir_size,
+    .get_rxfh = dummy_get_rxfh,
+    .set_rxfh = dummy_set_rxfh,
 };
 
 static struct rtnl_link_ops dummy_link_ops __read_mostly = {
     .kind = "dummy",
+    .priv_size = sizeof(struct dummy_priv),
     .setup = dummy_setup,
     .validate = dummy_validate,
+    .get_num_tx_queues = dummy_get_num_queues,
+    .get_num_rx_queues = dummy_get_num_queues,
 };
 
 /**
@@ -64,6 +239,89 @@ static struct rtnl_link_ops dummy_link_ops __read_mostly = {
  */
 static int num_devices = 1;
 
+/**
+ * The names of the events counted by the devices, in the
+ * order of their identifiers (ethtool -S).
+ */
+static const char dummy_events[DUMMY_EVENT_COUNT][ETH_GSTRING_LEN] = {
+    "rx_drop_queue_full",
+    "rx_drop_no_memory",
+    "tx_unanswered",
+    "tx_queue_stops",
+    "tx_mirror_drops",
+    "tx_peer_drops"
+};
+
+/**
+ * The number of devices to be registered under a single
+ * acquisition of the rtnl lock during the module load, the
+ * lock is released between batches so that other users of
+ * the lock are not starved when creating many devices.
+ */
+static int bulk_size = 64;
+
+/**
+ * If the devices registered during the module load should
+ * be linked in pairs (the first with the second, etc.), in
+ * which case the frames are forwarded instead of reflected.
+ */
+static int pair_devices = 0;
+
+/**
+ * The mode to be used for the statistics of the devices,
+ * controls the trade-off between the memory footprint of
+ * each device and the contention on the counters.
+ */
+static int stats_mode = DUMMY_STATS_PERCPU;
+
+/**
+ * The number of (transmit and receive) queues to be
+ * created for each of the devices, each receive queue
+ * has its own napi context.
+ */
+static int num_queues = 1;
+
+/**
+ * The root debugfs directory of the module, under which
+ * the directory of each of the devices is created (for the
+ * initial namespace, other namespaces have their own).
+ */
+static struct dentry *dummy_debugfs;
+
+/**
+ * The identifier of the (per network namespace) state
+ * of the driver, used to retrieve it from the namespace.
+ */
+static int dummy_net_id __read_mostly;
+
+/**
+ * The lock that serializes the creation and the release
+ * of the exported statistics pages of the devices.
+ */
+static DEFINE_MUTEX(dummy_export_mutex);
+
+/**
+ * The number of records of the (per cpu) capture rings,
+ * zero disables the capture (no memory is allocated).
+ */
+static int capture_slots = 512;
+
+/**
+ * The maximum number of bytes of each frame that are
+ * copied into a record of the capture rings.
+ */
+static int capture_snap_len = 96;
+
+/**
+ * The number of counters of each row of the (per cpu) heavy
+ * hitter sketches, zero disables the sketches.
+ */
+static int sketch_width = 256;
+
+static inline struct dummy_net *dummy_net(struct net_device *dev) {
+    return net_generic(dev_net(dev), dummy_net_id);
+}
+
 static int dummy_set_address(struct net_device *dev, void *parameters) {
     /* retrieves the socket address from the parameters */
     struct sockaddr *socket_address = parameters;
@@ -81,13 +339,56 @@ static int dummy_set_address(struct net_device *dev, void *parameters) {
 }
 
 static void dummy_set_multicast(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct mcast_filter *filter;
+    struct mcast_filter *previous;
+
+    /* updates the flag that controls if all the multicast
+    frames are accepted (no filtering) by the device */
+    priv->mc_all = dev->flags & (IFF_ALLMULTI | IFF_PROMISC) ? 1 : 0;
+
+    /* builds the new filter from the multicast list of the device
+    (the address lock is held) and replaces the previous one, that
+    is released once no reader may be using it, in case of failure
+    the previous filter remains in use */
+    filter = mcast_filter_build_c(dev, GFP_ATOMIC);
+    if(filter == NULL) { return; }
+
+    previous = rcu_dereference_protected(priv->mc_filter, 1);
+    rcu_assign_pointer(priv->mc_filter, filter);
+    if(previous != NULL) { kfree_rcu(previous, rcu); }
 }
 
 static struct rtnl_link_stats64 *dummy_get_stats64(struct net_device *dev, struct rtnl_link_stats64 *stats) {
-    /* initializes the index counter to be used
-    in the iteration over the cpus */
+    /* retrieves the private structure of the device, that
+    contains the compact statistics of the device */
+    struct dummy_priv *priv = netdev_priv(dev);
+
+    /* allocates space for the counters of the events (drops)
+    and for the index counter used in the iteration */
+    u64 events[DUMMY_EVENT_COUNT];
     int index;
 
+    /* adds the values of the compact statistics, these are
+    only updated in case the compact mode is in use and are
+    zero otherwise (no side effect on the sum) */
+    stats->rx_bytes += atomic64_read(&priv->cstats.rx_bytes);
+    stats->tx_bytes += atomic64_read(&priv->cstats.tx_bytes);
+    stats->rx_packets += atomic64_read(&priv->cstats.rx_packets);
+    stats->tx_packets += atomic64_read(&priv->cstats.tx_packets);
+
+    /* the frames dropped in the receive path (full queue or
+    no memory) are the ones reported as dropped, the full
+    queue is the equivalent of a nic fifo overrun */
+    dummy_stats_events(dev, events);
+    stats->rx_dropped += events[DUMMY_EVENT_QUEUE_FULL] + events[DUMMY_EVENT_NO_MEMORY];
+    stats->rx_fifo_errors += events[DUMMY_EVENT_QUEUE_FULL];
+
+    /* in case the per cpu statistics are not allocated (compact
+    or lazy mode on a device never opened) there's nothing more
+    to be added and the statistics are returned immediately */
+    if(dev->dstats == NULL) { return stats; }
+
     /* iterates over each of the possible cpus
     to update the information on each of them
     (each cpu contains a statistics structure) */
@@ -116,64 +417,185 @@ static struct rtnl_link_stats64 *dummy_get_stats64(struct net_device *dev, struc
     return stats;
 }
 
-static void dummy_xmit_p(struct sk_buff *skb, struct net_device *dev) {
-    int propagation;
-    unsigned int frame_size;
-    char *frame_buffer;
+static void dummy_stats_tx(struct net_device *dev, unsigned int len) {
+    struct pcpu_dstats *dstats;
+    struct dummy_priv *priv;
+
+    /* in case the per cpu statistics are not allocated
+    the compact (atomic) counters are used instead, this
+    is the case for the compact statistics mode */
+    if(unlikely(dev->dstats == NULL)) {
+        priv = netdev_priv(dev);
+        atomic64_inc(&priv->cstats.tx_packets);
+        atomic64_add(len, &priv->cstats.tx_bytes);
+        return;
+    }
+
+    /* retrieves the reference to the device statistics
+    structure that will be updated */
+    dstats = this_cpu_ptr(dev->dstats);
+
+    /* updates the statistics values, note that a
+    lock for the update operation is used, required
+    for syncing of operation */
+    u64_stats_update_begin(&dstats->syncp);
+    dstats->tx_packets++;
+    dstats->tx_bytes += len;
+    u64_stats_update_end(&dstats->syncp);
+}
+
+static void dummy_stats_rx(struct net_device *dev, unsigned int len) {
+    struct pcpu_dstats *dstats;
+    struct dummy_priv *priv;
+
+    /* updates only the receive counters, the frames are only
+    counted once they're queued for receive (not dropped) */
+    if(unlikely(dev->dstats == NULL)) {
+        priv = netdev_priv(dev);
+        atomic64_inc(&priv->cstats.rx_packets);
+        atomic64_add(len, &priv->cstats.rx_bytes);
+        return;
+    }
+
+    dstats = this_cpu_ptr(dev->dstats);
+    u64_stats_update_begin(&dstats->syncp);
+    dstats->rx_packets++;
+    dstats->rx_bytes += len;
+    u64_stats_update_end(&dstats->syncp);
+}
+
+static void dummy_stats_event(struct net_device *dev, unsigned int event) {
+    struct pcpu_dstats *dstats;
+    struct dummy_priv *priv;
+
+    if(unlikely(dev->dstats == NULL)) {
+        priv = netdev_priv(dev);
+        atomic64_inc(&priv->cstats.events[event]);
+        return;
+    }
+
+    dstats = this_cpu_ptr(dev->dstats);
+    u64_stats_update_begin(&dstats->syncp);
+    dstats->events[event]++;
+    u64_stats_update_end(&dstats->syncp);
+}
+
+static void dummy_stats_events(struct net_device *dev, u64 *events) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    const struct pcpu_dstats *dstats;
+    u64 values[DUMMY_EVENT_COUNT];
+    unsigned int start;
+    unsigned int event;
+    int index;
+
+    for(event = 0; event < DUMMY_EVENT_COUNT; event++) {
+        events[event] = atomic64_read(&priv->cstats.events[event]);
+    }
+
+    if(dev->dstats == NULL) { return; }
+
+    for_each_possible_cpu(index) {
+        dstats = per_cpu_ptr(dev->dstats, index);
+        do {
+            start = u64_stats_fetch_begin(&dstats->syncp);
+            memcpy(values, dstats->events, sizeof(values));
+        } while(u64_stats_fetch_retry(&dstats->syncp, start));
+
+        for(event = 0; event < DUMMY_EVENT_COUNT; event++) {
+            events[event] += values[event];
+        }
+    }
+}
+
+static int dummy_stats_alloc(struct net_device *dev) {
+    /* in case the statistics are already allocated (eg:
+    pre-allocated by the bulk creation) returns immediately */
+    if(dev->dstats != NULL) { return 0; }
+
+    dev->dstats = alloc_percpu(struct pcpu_dstats);
+    if(!dev->dstats) {
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+static int dummy_xmit_p(struct sk_buff *skb, struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
     struct sk_buff *skb_clone;
+    u32 fanout = min_t(u32, ACCESS_ONCE(priv->fanout), DUMMY_MAX_FANOUT);
+    int propagation;
 
-    /* retrieves the pointer reference to the mac header
-    and dat to be used in the processing of the message */
-    unsigned char *mac_header = skb->head + MAC_HEADER_OFFSET;
-    unsigned char *data = skb->data;
-
-    /* calculates the frame size using both the length
-    of the data part and the length of the header, then
-    allocates a new socket buffer for it */
-    frame_size = skb->len + ETH_HLEN;
-    skb_clone = dev_alloc_skb(frame_size);
-    frame_buffer = kmalloc(frame_size, GFP_ATOMIC);
-
-    /* in case either the skb clone or the frame buffer
-    are not allocated correctly return immediately */
-    if(skb_clone == NULL) { return; }
-    if(frame_buffer == NULL) { return; }
-
-    /* copies the header and the data parts of the frame
-    into the new frame buffer */
-    memcpy(frame_buffer, mac_header, ETH_HLEN);
-    memcpy(&(frame_buffer[ETH_HLEN]), data, skb->len);
-
-    /* sets the device of the socket buffer in the clone
-    (replication of the operation) */
-    skb_clone->dev = dev;
-
-    /* copies the frame buffer to the socket buffer clone
-    and then releases the memory of the frame buffer */
-    memcpy(skb_clone->data, frame_buffer, frame_size);
-    kfree(frame_buffer);
-
-    /* puts the frame size in the socket buffer, this should
-    update the internal buffer sizes, then updates the protocol
-    value in the clone with the ethernet value */
-    skb_put(skb_clone, frame_size);
-    skb_clone->protocol = eth_type_trans(skb_clone, dev);
-
-    /* propagates the packet over the stack and retrieves the
-    result of the propagation, printing a message according to
-    the result of the propagation */
-    propagation = netif_rx(skb_clone);
+    /* restores the mac header (including any in band vlan tag)
+    into the data of the socket buffer, note that no data is
+    copied and that the pages of a non linear frame are handed
+    over to the receive path by reference, the same applies to
+    the vlan tag that is kept in the metadata of the buffer */
+    skb_push(skb, skb->data - skb_mac_header(skb));
+
+    /* scrubs the state of the transmission path (destination,
+    netfilter, etc.) so that the buffer is received as new */
+    skb_scrub_packet(skb, false);
+
+    /* mirrors the response (in case it's requested) while the
+    data still starts at the mac header, sharing the data */
+    dummy_mirror(skb, dev, DUMMY_MIRROR_RESPONSE);
+
+    /* marks the frames whose checksum was computed by the stack
+    as verified, avoiding a new verification on receive */
+    if(skb->ip_summed == CHECKSUM_NONE && dev->features & NETIF_F_RXCSUM) {
+        skb->ip_summed = CHECKSUM_UNNECESSARY;
+    }
+
+    /* updates the protocol value of the buffer with the ethernet
+    value (resets the mac header) for the receive path */
+    skb->protocol = eth_type_trans(skb, dev);
+
+    /* computes the flow hash of the response (as a nic would do)
+    so that the stack doesn't have to compute it in software */
+    dummy_rss_hash(skb, dev);
+
+    /* in case the fan out is set, extra responses (clones) are
+    propagated for the frame, these share the data (headers and
+    pages) with the original response so no data is copied */
+    while(fanout-- > 1) {
+        skb_clone = skb_clone(skb, GFP_ATOMIC);
+        if(skb_clone == NULL) { dummy_stats_event(dev, DUMMY_EVENT_NO_MEMORY); break; }
+        DUMMY_SKB_CB(skb_clone)->bytes = 0;
+        dummy_rx_enqueue(skb_clone, dev, true);
+    }
+
+    /* propagates the packet over the stack (through the receive
+    queue and its napi context) and retrieves the result of the
+    propagation, printing a message according to the result */
+    propagation = dummy_rx_enqueue(skb, dev, true);
     switch(propagation) {
         case NET_RX_DROP:
-            printk("The packet was dropped while in propagation\n");
+            N_DEBUG("The packet was dropped while in propagation\n");
             break;
         case NET_RX_SUCCESS:
-            printk("The packet was sent successfully\n");
+            N_DEBUG("The packet was sent successfully\n");
             break;
         default:
-            printk("Unknown status for the packet\n");
+            N_DEBUG("Unknown status for the packet\n");
             break;
     }
+
+    return propagation;
+}
+
+static bool dummy_xmit_prepare(struct sk_buff *skb, unsigned int len) {
+    /* ensures that the requested number of bytes (headers)
+    is present in the linear part of the buffer, only these
+    bytes are pulled, the remaining fragments are untouched */
+    if(!pskb_may_pull(skb, len)) { return false; }
+
+    /* ensures that the header part of the buffer is not shared
+    with any clone (eg: tcp retransmission queue or taps) so that
+    it may be rewritten in place, the fragments stay shared */
+    if(skb_cow_head(skb, 0)) { return false; }
+
+    return true;
 }
 
 static void dummy_xmit_switch(struct sk_buff *skb, struct net_device *dev) {
@@ -184,7 +606,7 @@ static void dummy_xmit_switch(struct sk_buff *skb, struct net_device *dev) {
 
     /* retrieves the pointer reference to the mac header
     to be used in the processing of the message */
-    unsigned char *mac_header = skb->head + MAC_HEADER_OFFSET;
+    unsigned char *mac_header = skb_mac_header(skb);
 
     /* saves the receiver and serder mac buffers so that a switch between
     the receiver and sender of the packet is possible */
@@ -200,59 +622,328 @@ static void dummy_xmit_switch(struct sk_buff *skb, struct net_device *dev) {
 static void dummy_xmit_ensure(struct sk_buff *skb, struct net_device *dev) {
     /* retrieves the pointer reference to the mac header
     to be used in the processing of the message */
-    unsigned char *mac_header = skb->head + MAC_HEADER_OFFSET;
+    unsigned char *mac_header = skb_mac_header(skb);
 
-    /* sets the receiver of the packet as the sender of original
-    packet and sets the sender of the packet as the address of
-    the currently used device */
-    memcpy(&(mac_header[0]), &(mac_header[6]), MAC_ADDRESS_SIZE);
-    memcpy(&(mac_header[6]), dev->dev_addr, MAC_ADDRESS_SIZE);
+    /* delegates the rewrite of the header to the protocol code
+    that is shared with the userspace twin of the driver */
+    ethernet_reflect_c(mac_header, dev->dev_addr);
 }
 
-static void dummy_xmit_arp(struct sk_buff *skb, struct net_device *dev) {
-    /* allocates space for the sender and receiver parts
-    of arp resolution request and retrieves the reference
-    to the socket buffer's data */
-    unsigned char sender_sum[SUM_ADDRESS_SIZE];
-    unsigned char receiver_sum[SUM_ADDRESS_SIZE];
-    unsigned char *data = skb->data;
+static bool dummy_xmit_arp(struct sk_buff *skb, struct net_device *dev) {
+    /* ensures that the complete arp packet is available
+    for writing in the linear part of the buffer */
+    if(!dummy_xmit_prepare(skb, ARP_PACKET_SIZE)) { return false; }
 
     /* ensures the mac address header so that the packet
     is returned to the origin (network level response) */
     dummy_xmit_ensure(skb, dev);
 
-    /* sets the reply opcode in the arp data, should
-    be able to validate the packet*/
-    data[7] = 0x02;
+    /* rewrites the request into the reply announcing the
+    address of the device (shared protocol code) */
+    return arp_reflect_c(skb->data, skb_headlen(skb), dev->dev_addr) ? true : false;
+}
+
+static u8 dummy_xmit_dns(struct sk_buff *skb, struct net_device *dev) {
+    unsigned int len;
+
+    /* the complete query must be linear (queries are small) and
+    writable, with room in the buffer for the appended answer */
+    if(skb_linearize(skb)) { return DUMMY_RESPONDER_NONE; }
+    if(skb_tailroom(skb) < DNS_ANSWER_SIZE) {
+        if(pskb_expand_head(skb, 0, DNS_ANSWER_SIZE, GFP_ATOMIC)) { return DUMMY_RESPONDER_NONE; }
+    }
+    if(skb_cow_head(skb, 0)) { return DUMMY_RESPONDER_NONE; }
+
+    /* builds the response in place (after the question) and
+    resizes the buffer to the length of the response */
+    len = dns_reflect_c(&dummy_net(dev)->dns, skb->data, skb->len, skb->len + skb_tailroom(skb));
+    if(len == 0) { return DUMMY_RESPONDER_NONE; }
+    if(len > skb->len) { skb_put(skb, len - skb->len); } else { skb_trim(skb, len); }
+
+    /* the checksums were computed in full by the responder so any
+    partial checksum of the query (offload) no longer applies */
+    skb->ip_summed = CHECKSUM_NONE;
+
+    dummy_xmit_ensure(skb, dev);
+    return DUMMY_RESPONDER_DNS;
+}
 
-    /* copies the sender and the receiver addresses from
-    the arp packet to switch them */
-    memcpy(sender_sum, &(data[8]), SUM_ADDRESS_SIZE);
-    memcpy(receiver_sum, &(data[18]), SUM_ADDRESS_SIZE);
+static u8 dummy_xmit_canned(struct sk_buff *skb, struct net_device *dev, unsigned int header_size) {
+    struct canned_blob *blob;
+    unsigned int offset = 0;
+    unsigned int index;
+    u8 responder = DUMMY_RESPONDER_NONE;
+
+    rcu_read_lock();
+    blob = rcu_dereference(dummy_net(dev)->canned.blob);
+    if(blob == NULL) { goto unlock; }
+
+    /* discards the payload of the request (releasing its pages) so
+    that only the (writable) network and udp headers are kept */
+    if(pskb_trim(skb, header_size + sizeof(struct udphdr))) { goto unlock; }
+    if(skb_is_nonlinear(skb)) { goto unlock; }
+
+    /* rewrites the headers from the templates of the payload and
+    attaches the (read only) pages of the payload by reference, no
+    data is copied and the pages must not be written in place */
+    canned_reflect_c(blob, skb->data, header_size);
+    for(index = 0; index < blob->count; index++) {
+        get_page(blob->pages[index]);
+        skb_fill_page_desc(skb, index, blob->pages[index], 0,
+            min_t(unsigned int, blob->size - offset, PAGE_SIZE));
+        offset += PAGE_SIZE;
+    }
+    skb->len += blob->size;
+    skb->data_len += blob->size;
+    skb->truesize += blob->count * PAGE_SIZE;
+    skb_shinfo(skb)->tx_flags |= SKBTX_SHARED_FRAG;
 
-    /* switches the receiver and sender packets so that
-    a valid response is sent */
-    memcpy(&(data[8]), receiver_sum, SUM_ADDRESS_SIZE);
-    memcpy(&(data[18]), sender_sum, SUM_ADDRESS_SIZE);
+    /* the checksums were computed in full by the responder so any
+    partial checksum of the request (offload) no longer applies */
+    skb->ip_summed = CHECKSUM_NONE;
 
-    /* copies the current device address to the sender
-    position for the address so that all the ip addresses
-    in the current sub network are assigned to this device */
-    memcpy(&(data[8]), dev->dev_addr, MAC_ADDRESS_SIZE);
+    dummy_xmit_ensure(skb, dev);
+    responder = DUMMY_RESPONDER_CANNED;
 
-    /* duplicates (clones) the socket buffer and then propagates
-    the cloned value over the stack, retrievinf the result */
-    dummy_xmit_p(skb, dev);
+unlock:
+    rcu_read_unlock();
+    return responder;
 }
 
-static void dummy_xmit_ip(struct sk_buff *skb, struct net_device *dev) {
+static u8 dummy_xmit_ip(struct sk_buff *skb, struct net_device *dev) {
+    unsigned int header_size;
+
+    /* ensures that the ip header (including options) and the
+    start of the transport header are available for writing, the
+    smaller size is used for short packets (eg: last fragments) */
+    if(!pskb_may_pull(skb, sizeof(struct iphdr))) { return DUMMY_RESPONDER_NONE; }
+    header_size = ((struct iphdr *) skb->data)->ihl * 4;
+    if(!dummy_xmit_prepare(skb, min_t(unsigned int, skb->len, header_size + TRANSPORT_HEADER_SIZE))) {
+        return DUMMY_RESPONDER_NONE;
+    }
+
     N_DEBUG_F("Packet type: %d\n", skb->data[9]);
+
+    /* queries for the dns port are answered by the dns responder
+    (in case a table of names is loaded) instead of reflected */
+    if(dns_query_c(&dummy_net(dev)->dns, skb->data, skb_headlen(skb))) { return dummy_xmit_dns(skb, dev); }
+
+    /* datagrams for the ports of the canned responder are answered
+    with its (preloaded) payload instead of being reflected */
+    header_size = canned_query_c(&dummy_net(dev)->canned, skb->data, skb_headlen(skb));
+    if(header_size > 0) { return dummy_xmit_canned(skb, dev, header_size); }
+
+    /* rewrites the ip packet (in place) into its response and
+    in case it's not meant to be reflected returns immediately */
+    if(!ipv4_reflect_c(skb->data, skb_headlen(skb))) { return DUMMY_RESPONDER_NONE; }
+
+    /* ensures the mac address header so that the packet
+    is returned to the origin */
+    dummy_xmit_ensure(skb, dev);
+    return DUMMY_RESPONDER_IP;
 }
 
-static void dummy_xmit_e(struct sk_buff *skb, struct net_device *dev) {
-    /* retrieves the pointer reference to the mac header
-    to be used in the processing of the message */
-    unsigned char *mac_header = skb->head + MAC_HEADER_OFFSET;
+static struct sk_buff *dummy_rx_build(struct net_device *dev, unsigned int size) {
+    struct sk_buff *skb;
+
+    /* allocates a new frame with the requested size of data
+    (aligned so that the network header is aligned) */
+    skb = netdev_alloc_skb_ip_align(dev, size);
+    if(skb == NULL) { return NULL; }
+    skb_put(skb, size);
+
+    return skb;
+}
+
+static int dummy_rx_inject(struct sk_buff *skb, struct net_device *dev) {
+    /* prepares the (newly built) frame for receive and queues
+    it in the receive queue (accounted once queued) */
+    skb->protocol = eth_type_trans(skb, dev);
+    skb->ip_summed = CHECKSUM_UNNECESSARY;
+    dummy_rss_hash(skb, dev);
+    return dummy_rx_enqueue(skb, dev, true);
+}
+
+static bool dummy_xmit_igmp(struct sk_buff *skb, struct net_device *dev) {
+    struct in_device *in_dev;
+    struct ip_mc_list *mc;
+    struct sk_buff *report;
+    __be32 group;
+    __be32 source;
+    __be32 peer;
+
+    if(!pskb_may_pull(skb, sizeof(struct iphdr))) { return false; }
+    if(!pskb_may_pull(skb, ((struct iphdr *) skb->data)->ihl * 4 + sizeof(struct igmphdr))) { return false; }
+    if(!igmp_query_c(skb->data, skb_headlen(skb), &group, &source)) { return false; }
+
+    N_DEBUG("Received an IGMP query...\n");
+
+    /* the reports are sent from the peer of the querier (the
+    address with the last bit flipped) as an emulated member
+    of the groups, the querier itself is a local address */
+    peer = source ^ htonl(1);
+
+    /* iterates over the groups joined in the device and sends
+    a report for each of them (or only the queried group) */
+    rcu_read_lock();
+    in_dev = __in_dev_get_rcu(dev);
+    for(mc = in_dev ? rcu_dereference(in_dev->mc_list) : NULL; mc != NULL; mc = rcu_dereference(mc->next_rcu)) {
+        if(mc->multiaddr == htonl(INADDR_ALLHOSTS_GROUP)) { continue; }
+        if(group != 0 && mc->multiaddr != group) { continue; }
+
+        report = dummy_rx_build(dev, IGMP_REPORT_SIZE);
+        if(report == NULL) { dummy_stats_event(dev, DUMMY_EVENT_NO_MEMORY); break; }
+        igmp_report_c(report->data, dev->dev_addr, peer, mc->multiaddr);
+        dummy_rx_inject(report, dev);
+    }
+    rcu_read_unlock();
+
+    return true;
+}
+
+static bool dummy_xmit_mld(struct sk_buff *skb, struct net_device *dev) {
+#if IS_ENABLED(CONFIG_IPV6)
+    struct inet6_dev *idev;
+    struct ifmcaddr6 *mc;
+    struct sk_buff *report;
+    struct in6_addr group;
+    struct in6_addr source;
+
+    if(!pskb_may_pull(skb, min_t(unsigned int, skb->len,
+        sizeof(struct ipv6hdr) + 8 + sizeof(struct mld_msg)))) { return false; }
+    if(!mld_query_c(skb->data, skb_headlen(skb), &group, &source)) { return false; }
+
+    N_DEBUG("Received an MLD query...\n");
+
+    /* the reports are sent from the peer of the querier (last
+    bit of the link local address flipped) as an emulated
+    listener of the groups, the querier is a local address */
+    source.s6_addr[15] ^= 0x01;
+
+    rcu_read_lock();
+    idev = __in6_dev_get(dev);
+    if(idev != NULL) {
+        read_lock_bh(&idev->lock);
+        for(mc = idev->mc_list; mc != NULL; mc = mc->next) {
+            if(ipv6_addr_is_ll_all_nodes(&mc->mca_addr)) { continue; }
+            if(!ipv6_addr_any(&group) && !ipv6_addr_equal(&mc->mca_addr, &group)) { continue; }
+
+            report = dummy_rx_build(dev, MLD_REPORT_SIZE);
+            if(report == NULL) { dummy_stats_event(dev, DUMMY_EVENT_NO_MEMORY); break; }
+            mld_report_c(report->data, dev->dev_addr, &source, &mc->mca_addr);
+            dummy_rx_inject(report, dev);
+        }
+        read_unlock_bh(&idev->lock);
+    }
+    rcu_read_unlock();
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+static u8 dummy_xmit_mc(struct sk_buff *skb, struct net_device *dev, unsigned char *type_header) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct mcast_filter *filter;
+    u8 responder;
+    bool match;
+
+    /* handles the multicast control protocols (and the neighbor
+    solicitations that are sent to the solicited node groups) */
+    if(IS_IP_REQUEST(type_header)) {
+        if(dummy_xmit_igmp(skb, dev)) { return DUMMY_RESPONDER_NONE; }
+    } else if(IS_IPV6_REQUEST(type_header)) {
+        responder = dummy_xmit_ipv6(skb, dev);
+        if(responder != DUMMY_RESPONDER_NONE) { return responder; }
+        if(dummy_xmit_mld(skb, dev)) { return DUMMY_RESPONDER_NONE; }
+    }
+
+    /* verifies (constant time) that the group of the frame is
+    joined in the device, only then the frame is delivered back
+    (unchanged) to the stack, otherwise it's filtered */
+    rcu_read_lock();
+    filter = rcu_dereference(priv->mc_filter);
+    match = ACCESS_ONCE(priv->mc_all) || mcast_filter_match_c(filter, skb_mac_header(skb));
+    rcu_read_unlock();
+
+    return match ? DUMMY_RESPONDER_MULTICAST : DUMMY_RESPONDER_NONE;
+}
+
+static bool dummy_xmit_owns(struct net_device *dev, const struct in6_addr *address) {
+    bool result = false;
+#if IS_ENABLED(CONFIG_IPV6)
+    struct inet6_dev *idev;
+    struct inet6_ifaddr *ifaddr;
+
+    /* iterates over the addresses configured in the device
+    to check if the provided address is part of any of the
+    prefixes, all of these addresses are owned by the device
+    (the same way any address is owned for arp) */
+    rcu_read_lock();
+    idev = __in6_dev_get(dev);
+    if(idev != NULL) {
+        read_lock_bh(&idev->lock);
+        list_for_each_entry(ifaddr, &idev->addr_list, if_list) {
+            if(!ipv6_prefix_equal(&ifaddr->addr, address, ifaddr->prefix_len)) { continue; }
+            result = true;
+            break;
+        }
+        read_unlock_bh(&idev->lock);
+    }
+    rcu_read_unlock();
+#endif
+    return result;
+}
+
+static u8 dummy_xmit_ipv6(struct sk_buff *skb, struct net_device *dev) {
+    struct in6_addr *target;
+    unsigned int header_size;
+
+    /* ensures that the ipv6 header and the start of the transport
+    header (or the neighbor solicitation) are available for writing,
+    the smaller transport header is used if the packet is short */
+    if(!dummy_xmit_prepare(skb, min_t(unsigned int, skb->len,
+        sizeof(struct ipv6hdr) + NDISC_MESSAGE_SIZE + NDISC_OPTION_SIZE))) { return DUMMY_RESPONDER_NONE; }
+
+    /* retrieves the target of the neighbor solicitation in case
+    the packet is one, these are answered with an advertisement
+    for any address in the prefixes configured in the device */
+    target = ndisc_target_c(skb->data, skb_headlen(skb));
+    if(target != NULL) {
+        N_DEBUG("Received an NDP solicitation...\n");
+        if(!dummy_xmit_owns(dev, target)) { return DUMMY_RESPONDER_NONE; }
+        if(!ndisc_reflect_c(skb->data, skb_headlen(skb), dev->dev_addr)) { return DUMMY_RESPONDER_NONE; }
+
+        /* trims the packet to the size of the advertisement
+        (options from the solicitation are discarded) */
+        if(pskb_trim(skb, sizeof(struct ipv6hdr) + ntohs(((struct ipv6hdr *) skb->data)->payload_len))) {
+            return DUMMY_RESPONDER_NONE;
+        }
+    } else if(dns_query_c(&dummy_net(dev)->dns, skb->data, skb_headlen(skb))) {
+        return dummy_xmit_dns(skb, dev);
+    } else if((header_size = canned_query_c(&dummy_net(dev)->canned, skb->data, skb_headlen(skb))) > 0) {
+        return dummy_xmit_canned(skb, dev, header_size);
+    } else if(!ipv6_reflect_c(skb->data, skb_headlen(skb))) {
+        return DUMMY_RESPONDER_NONE;
+    }
+
+    /* ensures the mac address header so that the packet
+    is returned to the origin */
+    dummy_xmit_ensure(skb, dev);
+    return DUMMY_RESPONDER_IPV6;
+}
+
+static u8 dummy_xmit_e(struct sk_buff *skb, struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+
+    /* allocates space for the pointer reference to the mac
+    header and for the header used in the type resolution
+    and for the responder that built the response */
+    unsigned char *mac_header;
+    unsigned char *type_header;
+    u8 responder = DUMMY_RESPONDER_NONE;
+    int verdict;
 
     /* prints a debug message to kernel log */
     N_DEBUG("Started echo operation...\n");
@@ -266,6 +957,24 @@ static void dummy_xmit_e(struct sk_buff *skb, struct net_device *dev) {
     skb->protocol = eth_type_trans(skb, dev);
     skb->mac_len = ETH_HLEN;
 
+    /* retrieves the pointer reference to the mac header
+    to be used in the processing of the message, by default
+    the type is resolved from the (untagged) mac header */
+    mac_header = skb_mac_header(skb);
+    type_header = mac_header;
+
+    /* in case the frame contains an in band vlan tag (no offload)
+    the tag is skipped (no data is moved) and the type header
+    is shifted so that the inner type is used for resolution */
+    if(IS_VLAN_REQUEST(mac_header)) {
+        if(!pskb_may_pull(skb, VLAN_HLEN)) { return DUMMY_RESPONDER_NONE; }
+        mac_header = skb_mac_header(skb);
+        type_header = mac_header + VLAN_HLEN;
+        skb_pull(skb, VLAN_HLEN);
+        skb->mac_len = ETH_HLEN + VLAN_HLEN;
+    }
+
+#ifdef DUMMY_DEBUG
     /* prints the address of the current device
     to the standard outpud (deubg) */
     print_addr_c((unsigned char *) dev->dev_addr);
@@ -274,134 +983,1916 @@ static void dummy_xmit_e(struct sk_buff *skb, struct net_device *dev) {
     buffer into the logging structures */
     print_head_c(skb);
     print_data_c(skb);
+#endif
 
-    if(IS_ARP_REQUEST(mac_header)) {
+    /* updates the heavy hitter sketches with the flow of the
+    frame (constant cost) in case the tracking is enabled */
+    if(ACCESS_ONCE(priv->sketch)) {
+        sketch_update_c(skb->data, skb_headlen(skb), *(__be16 *) &(type_header[12]));
+    }
+
+    /* hands the frame to the responder registered (by another
+    module) for its key, in case there's one, that may reflect
+    or consume the frame or pass it to the built in responders */
+    verdict = responder_dispatch_c(skb, dev, *(__be16 *) &(type_header[12]));
+    switch(verdict) {
+        case DUMMY_VERDICT_REFLECT:
+            /* the mac header may still be shared with a clone (eg:
+            packet taps or mirroring) in case the responder didn't prepare it */
+            if(skb_cow_head(skb, 0)) { return DUMMY_RESPONDER_NONE; }
+            dummy_xmit_ensure(skb, dev);
+            return DUMMY_RESPONDER_CUSTOM;
+        case DUMMY_VERDICT_CONSUME:
+            return DUMMY_RESPONDER_CONSUMED;
+    }
+
+    /* the responder may have prepared the frame (pull or copy on
+    write) moving its data to a new buffer, so the pointers to the
+    headers are resolved again before the built in responders */
+    mac_header = skb_mac_header(skb);
+    type_header = mac_header + (skb->mac_len - ETH_HLEN);
+
+    if(IS_ARP_REQUEST(type_header)) {
         N_DEBUG("Received an ARP packet...\n");
-        dummy_xmit_arp(skb, dev);
-    } else if(IS_IP_REQUEST(mac_header)) {
+        if(dummy_xmit_arp(skb, dev)) { responder = DUMMY_RESPONDER_ARP; }
+    } else if(is_multicast_ether_addr(mac_header) && !is_broadcast_ether_addr(mac_header)) {
+        N_DEBUG("Received a multicast packet...\n");
+        responder = dummy_xmit_mc(skb, dev, type_header);
+    } else if(IS_IP_REQUEST(type_header)) {
         N_DEBUG("Received an IP packet...\n");
-        dummy_xmit_ip(skb, dev);
+        responder = dummy_xmit_ip(skb, dev);
+    } else if(IS_IPV6_REQUEST(type_header)) {
+        N_DEBUG("Received an IPv6 packet...\n");
+        responder = dummy_xmit_ipv6(skb, dev);
     }
 
     /* prints a debug message to kernel log */
     N_DEBUG("Finished echo operation...\n");
+
+    return responder;
 }
 
 static netdev_tx_t dummy_xmit(struct sk_buff *skb, struct net_device *dev) {
-    /* retrieves the reference to the device statistics
-    structure that will be updated */
-    struct pcpu_dstats *dstats = this_cpu_ptr(dev->dstats);
+    dummy_xmit_r(skb, dev);
+    return NETDEV_TX_OK;
+}
 
-    /* updates the statistics values, note that a
-    lock for the update operation is used, required
-    for syncing of operation */
-    u64_stats_update_begin(&dstats->syncp);
-    dstats->rx_packets++;
-    dstats->tx_packets++;
-    dstats->rx_bytes += skb->len;
-    dstats->tx_bytes += skb->len;
-    u64_stats_update_end(&dstats->syncp);
+static u8 dummy_xmit_r(struct sk_buff *skb, struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct capture_record *record;
+    struct netdev_queue *txq = netdev_get_tx_queue(dev, skb_get_queue_mapping(skb));
+    struct net_device *peer;
+    unsigned int len = skb->len;
+    int propagation;
+    u8 responder;
+
+    /* generates the (software) transmit timestamp of the frame
+    in case it was requested by the socket (SO_TIMESTAMPING), at
+    the moment it's taken by the driver and before it's orphaned */
+    skb_tx_timestamp(skb);
+
+    /* updates the transmit statistics of the device, using
+    either the per cpu or the compact counters, the receive
+    side is only accounted once a response is queued */
+    dummy_stats_tx(dev, skb->len);
+
+    /* starts the capture record of the frame (in case it's
+    sampled) before the frame is changed by the responders */
+    record = capture_begin_c(skb, ACCESS_ONCE(priv->capture_rate));
+
+    /* mirrors the frame as taken by the device (in case it's
+    requested), the responders only rewrite a private copy of
+    the headers as these are shared with the mirrored clone */
+    dummy_mirror(skb, dev, DUMMY_MIRROR_REQUEST);
+
+    /* in case the device is linked with a peer the frame is
+    delivered on the peer instead of being answered, its bytes
+    are not accounted (byte queue limits) as these would have
+    to be completed by the receive queues of the peer */
+    peer = rcu_dereference_bh(priv->peer);
+    if(peer != NULL) {
+        propagation = dummy_xmit_f(skb, dev, peer);
+        capture_end_c(
+            record,
+            DUMMY_RESPONDER_NONE,
+            propagation == NET_RX_SUCCESS ? CAPTURE_VERDICT_FORWARDED : CAPTURE_VERDICT_DROPPED
+        );
+        return DUMMY_RESPONDER_NONE;
+    }
 
     /* runs the echo operation for the transmission
-    of the packet (loop back) */
-    dummy_xmit_e(skb, dev);
+    of the packet (loop back), in case no response is
+    built the frame is released, avoiding any leak */
+    responder = dummy_xmit_e(skb, dev);
+    if(responder == DUMMY_RESPONDER_NONE) {
+        capture_end_c(record, responder, CAPTURE_VERDICT_PASSED);
+        dummy_stats_event(dev, DUMMY_EVENT_UNANSWERED);
+        dev_kfree_skb(skb);
+        return responder;
+    }
 
-    /* releases the skb structure, avoids any
-    memory leak and returns with no error */
-    dev_kfree_skb(skb);
-    return NETDEV_TX_OK;
+    /* in case the frame was consumed by a registered responder
+    it's no longer owned by the driver (nothing to propagate) */
+    if(responder == DUMMY_RESPONDER_CONSUMED) {
+        capture_end_c(record, DUMMY_RESPONDER_CUSTOM, CAPTURE_VERDICT_CONSUMED);
+        return DUMMY_RESPONDER_CUSTOM;
+    }
+
+    /* accounts the bytes of the frame as queued in the transmit
+    queue (byte queue limits), these are only completed once the
+    response is received (or dropped), so that the bytes in flight
+    inside the driver are bounded, the accounting must precede the
+    queuing as the response may be received (on other cpu) at once */
+    DUMMY_SKB_CB(skb)->bytes = len;
+    DUMMY_SKB_CB(skb)->queue = skb_get_queue_mapping(skb);
+    netdev_tx_sent_queue(txq, len);
+
+    /* propagates the response (the buffer itself) over
+    the stack, the buffer is consumed by the propagation */
+    propagation = dummy_xmit_p(skb, dev);
+    if(propagation != NET_RX_SUCCESS) { netdev_tx_completed_queue(txq, 1, len); }
+    capture_end_c(
+        record,
+        responder,
+        propagation == NET_RX_SUCCESS ? CAPTURE_VERDICT_REFLECTED : CAPTURE_VERDICT_DROPPED
+    );
+    return responder;
 }
 
-static int dummy_dev_init(struct net_device *dev) {
-    dev->dstats = alloc_percpu(struct pcpu_dstats);
-    if(!dev->dstats) {
-        return -ENOMEM;
+static int dummy_change_mtu(struct net_device *dev, int new_mtu) {
+    /* verifies that the new maximum transmit unit is in
+    the valid range for the device (up to jumbo frames) */
+    if(new_mtu < DUMMY_MIN_MTU || new_mtu > DUMMY_MAX_MTU) {
+        return -EINVAL;
     }
 
+    dev->mtu = new_mtu;
     return 0;
 }
 
-static void dummy_dev_uninit(struct net_device *dev) {
-    /* releases the device statistics structure
-    in a per cpu basis (for all cpus) */
-    free_percpu(dev->dstats);
+static void dummy_rss_hash(struct sk_buff *skb, struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    unsigned char tuple[FLOW_TUPLE_SIZE];
+    unsigned int tuple_size;
+    bool ports;
+    u32 hash;
+
+    /* in case the receive hashing is disabled (ethtool) there's
+    nothing to be done, the stack computes the hash if needed */
+    if(!(dev->features & NETIF_F_RXHASH)) { return; }
+
+    /* extracts the flow tuple from the (linear) headers of the
+    frame, frames that are not ip have no hash */
+    tuple_size = flow_tuple_c(skb->data, skb_headlen(skb), skb->protocol, tuple, &ports);
+    if(tuple_size == 0) { return; }
+
+    /* computes the hash using the configured function, toeplitz
+    (the one used by the nics) or jhash (cheaper to compute) */
+    if(priv->rss_hash == DUMMY_RSS_JHASH) {
+        hash = jhash(tuple, tuple_size, *(u32 *) priv->rss_key);
+    } else {
+        hash = toeplitz_hash_c(priv->rss_key, DUMMY_RSS_KEY_SIZE, tuple, tuple_size);
+    }
+
+    skb_set_hash(skb, hash, ports ? PKT_HASH_TYPE_L4 : PKT_HASH_TYPE_L3);
 }
 
-static void dummy_setup(struct net_device *dev) {
-    /* runs the ethernet setup operation on
-    the device (generic startup) */
-    ether_setup(dev);
+static inline unsigned int dummy_rx_pending(struct dummy_rx_queue *rx_queue) {
+    /* the pending frames are the ones in the input queue and
+    the ones spliced into the (local) queue of the poll */
+    return skb_queue_len(&rx_queue->input) + ACCESS_ONCE(rx_queue->process.qlen);
+}
 
-    /* initializes the device structure */
-    dev->netdev_ops = &dummy_netdev_ops;
-    dev->destructor = free_netdev;
+static void dummy_rx_kick(void *data) {
+    struct dummy_rx_queue *rx_queue = data;
 
-    /* sets the maximum transmit unit, this should
-    be the normal value */
-    dev->mtu = 1500;
+    /* runs in the (interrupt) context of the cpu of the queue
+    scheduling its napi context, the kick state is cleared first
+    so that any new frame triggers a new kick */
+    clear_bit(DUMMY_RX_KICK, &rx_queue->state);
+    napi_schedule(&rx_queue->napi);
+}
 
-    /* fills in device structure with ethernet generic values
-    this should allows the device to run properly */
-    dev->tx_queue_len = 0;
-    random_ether_addr(dev->dev_addr);
+static int dummy_rx_enqueue(struct sk_buff *skb, struct net_device *dev, bool flow) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_rx_queue *rx_queue;
+    u16 index = skb_get_queue_mapping(skb);
+    u16 tx_index = index;
+    unsigned int len = skb->len + (skb->data - skb_mac_header(skb));
+    unsigned int pending;
+    bool steer = ACCESS_ONCE(priv->rss_steer) && skb_get_hash_raw(skb);
+
+    /* retrieves the receive queue for the frame, either from the
+    indirection table (steering) or the one paired with the transmit
+    queue used by the frame, and records it in the frame */
+    if(steer) { index = priv->rss_indir[skb_get_hash_raw(skb) % DUMMY_RSS_INDIR_SIZE]; }
+    if(unlikely(index >= dev->real_num_rx_queues)) { index = 0; }
+    rx_queue = &priv->rx_queues[index];
+    skb_record_rx_queue(skb, index);
+
+    /* in case the queue is already full the frame is dropped
+    as there's no more space for it in the "ring", the pending
+    frames include the ones already spliced by the poll */
+    pending = dummy_rx_pending(rx_queue);
+    if(unlikely(pending >= DUMMY_RX_QUEUE_SIZE)) {
+        dummy_stats_event(dev, DUMMY_EVENT_QUEUE_FULL);
+        kfree_skb(skb);
+        return NET_RX_DROP;
+    }
+
+    /* adds the frame to the input queue and schedules the
+    napi context, that is going to run in the current cpu
+    (unless it's already scheduled) emulating an interrupt,
+    the frame is stamped at this moment in case it's requested
+    (otherwise the stack stamps it when received by the poll) */
+    if(ACCESS_ONCE(priv->rx_timestamp)) { __net_timestamp(skb); }
+    skb_mark_napi_id(skb, &rx_queue->napi);
+    skb_queue_tail(&rx_queue->input, skb);
+    dummy_stats_rx(dev, len);
+
+    /* in case the queue is congested the transmit queue of the
+    frame is stopped (flow control towards the qdisc) instead
+    of having the next frames dropped once the queue is full,
+    frames from other devices (peers) are simply dropped */
+    if(unlikely(pending + 1 >= DUMMY_RX_QUEUE_STOP) && flow) { dummy_tx_stop(dev, rx_queue, tx_index); }
+
+    /* in case the interrupt is coalesced (held until a number of
+    frames or a deadline) there's nothing more to be done */
+    if(dummy_rx_coalesce(rx_queue)) { return NET_RX_SUCCESS; }
+
+    dummy_rx_signal(rx_queue, steer);
+    return NET_RX_SUCCESS;
 }
 
-static int dummy_validate(struct nlattr *tb[], struct nlattr *data[]) {
-    if(tb[IFLA_ADDRESS]) {
-        if(nla_len(tb[IFLA_ADDRESS]) != ETH_ALEN) {
-            return -EINVAL;
-        }
-        if(!is_valid_ether_addr(nla_data(tb[IFLA_ADDRESS]))) {
-            return -EADDRNOTAVAIL;
+static void dummy_rx_signal(struct dummy_rx_queue *rx_queue, bool remote) {
+    /* in case the frame is steered to a queue of another cpu the
+    interrupt is emulated by an ipi to that cpu (only one kick
+    may be pending per queue), so that the napi runs there */
+    if(remote && rx_queue->cpu != smp_processor_id() && cpu_online(rx_queue->cpu)) {
+        if(!test_and_set_bit(DUMMY_RX_KICK, &rx_queue->state)) {
+            smp_call_function_single_async(rx_queue->cpu, &rx_queue->csd);
         }
+        return;
     }
 
-    return 0;
+    napi_schedule(&rx_queue->napi);
 }
 
-static int __init dummy_init_one(void) {
-    struct net_device *dev_dummy;
-    int error;
+static bool dummy_rx_coalesce(struct dummy_rx_queue *rx_queue) {
+    u32 usecs = ACCESS_ONCE(rx_queue->usecs);
+    u32 frames = ACCESS_ONCE(rx_queue->frames);
+    int count;
+
+    /* with no time limit there's no coalescing (a frame limit
+    alone could hold the frames forever) */
+    if(usecs == 0) { return false; }
+
+    /* in case the frame limit is reached the interrupt is raised
+    now (and the deadline cancelled), otherwise the first frame
+    held arms the deadline for the interrupt */
+    count = atomic_inc_return(&rx_queue->coalesced);
+    if(frames != 0 && count >= frames) {
+        atomic_set(&rx_queue->coalesced, 0);
+        hrtimer_try_to_cancel(&rx_queue->timer);
+        return false;
+    }
+    if(count == 1) {
+        hrtimer_start(&rx_queue->timer, ns_to_ktime((u64) usecs * NSEC_PER_USEC), HRTIMER_MODE_REL);
+    }
 
-    dev_dummy = alloc_netdev(0, "dummy%d", dummy_setup);
-    if(!dev_dummy) { return -ENOMEM; }
+    return true;
+}
 
-    dev_dummy->rtnl_link_ops = &dummy_link_ops;
-    error = register_netdevice(dev_dummy);
-    if(error < 0) { goto error; }
+static enum hrtimer_restart dummy_rx_timer(struct hrtimer *timer) {
+    struct dummy_rx_queue *rx_queue = container_of(timer, struct dummy_rx_queue, timer);
+
+    /* the deadline of the held frames has been reached, the
+    interrupt is raised on the cpu of the queue */
+    atomic_set(&rx_queue->coalesced, 0);
+    dummy_rx_signal(rx_queue, true);
+    return HRTIMER_NORESTART;
+}
+
+static void dummy_rx_adapt(struct dummy_priv *priv, struct dummy_rx_queue *rx_queue, int done) {
+    struct ethtool_coalesce *coalesce = &priv->coalesce;
+    u64 now = local_clock();
+    u64 elapsed;
+    u64 rate;
+
+    /* accumulates the frames received in the current window and
+    once it's complete the rate of the queue selects the values of
+    the coalescing (low, normal or high rate values) */
+    rx_queue->window_frames += done;
+    elapsed = now - rx_queue->window_start;
+    if(elapsed < DUMMY_COALESCE_WINDOW_NS) { return; }
+
+    rate = div64_u64((u64) rx_queue->window_frames * NSEC_PER_SEC, elapsed);
+    if(rate < coalesce->pkt_rate_low) {
+        ACCESS_ONCE(rx_queue->usecs) = coalesce->rx_coalesce_usecs_low;
+        ACCESS_ONCE(rx_queue->frames) = coalesce->rx_max_coalesced_frames_low;
+    } else if(rate > coalesce->pkt_rate_high) {
+        ACCESS_ONCE(rx_queue->usecs) = coalesce->rx_coalesce_usecs_high;
+        ACCESS_ONCE(rx_queue->frames) = coalesce->rx_max_coalesced_frames_high;
+    } else {
+        ACCESS_ONCE(rx_queue->usecs) = coalesce->rx_coalesce_usecs;
+        ACCESS_ONCE(rx_queue->frames) = coalesce->rx_max_coalesced_frames;
+    }
+
+    rx_queue->window_start = now;
+    rx_queue->window_frames = 0;
+}
+
+static void dummy_tx_stop(struct net_device *dev, struct dummy_rx_queue *rx_queue, u16 index) {
+    if(unlikely(index >= dev->real_num_tx_queues)) { return; }
+    if(test_and_set_bit(index, rx_queue->stopped)) { return; }
+
+    netif_tx_stop_queue(netdev_get_tx_queue(dev, index));
+    dummy_stats_event(dev, DUMMY_EVENT_QUEUE_STOP);
+
+    /* verifies the queue again after the stop as the poll may
+    have drained it (without seeing the stop) in the meantime,
+    in which case the transmit queue is woken immediately */
+    smp_mb__after_atomic();
+    if(dummy_rx_pending(rx_queue) < DUMMY_RX_QUEUE_WAKE) {
+        clear_bit(index, rx_queue->stopped);
+        netif_tx_wake_queue(netdev_get_tx_queue(dev, index));
+    }
+}
+
+static void dummy_tx_wake(struct net_device *dev, struct dummy_rx_queue *rx_queue) {
+    unsigned int index;
+
+    for_each_set_bit(index, rx_queue->stopped, dev->num_tx_queues) {
+        if(!test_and_clear_bit(index, rx_queue->stopped)) { continue; }
+        netif_tx_wake_queue(netdev_get_tx_queue(dev, index));
+    }
+}
+
+static inline void dummy_tx_account(struct dummy_rx_queue *rx_queue, struct sk_buff *skb) {
+    struct dummy_skb_cb *cb = DUMMY_SKB_CB(skb);
+
+    /* accumulates the completion of the frame (if it carries
+    bytes of a transmit queue) before the control block is
+    overwritten by the receive path of the stack */
+    if(cb->bytes == 0) { return; }
+    rx_queue->completions[cb->queue].frames++;
+    rx_queue->completions[cb->queue].bytes += cb->bytes;
+    __set_bit(cb->queue, rx_queue->completed);
+}
+
+static void dummy_tx_complete(struct net_device *dev, struct dummy_rx_queue *rx_queue) {
+    struct dummy_tx_completion *completion;
+    struct netdev_queue *txq;
+    unsigned int index;
+
+    /* reports the accumulated completions to each of the transmit
+    queues, under the lock of the queue as the completions of a
+    transmit queue may come from several receive queues (cpus) */
+    for_each_set_bit(index, rx_queue->completed, dev->num_tx_queues) {
+        completion = &rx_queue->completions[index];
+        txq = netdev_get_tx_queue(dev, index);
+        __netif_tx_lock(txq, smp_processor_id());
+        netdev_tx_completed_queue(txq, completion->frames, completion->bytes);
+        __netif_tx_unlock(txq);
+        completion->frames = 0;
+        completion->bytes = 0;
+        __clear_bit(index, rx_queue->completed);
+    }
+}
+
+static struct sk_buff *dummy_rx_dequeue(struct dummy_rx_queue *rx_queue) {
+    /* in case the local (process) queue is empty the input
+    queue is spliced into it under a single lock acquisition
+    so that frames are then processed without locking */
+    if(skb_queue_empty(&rx_queue->process)) {
+        spin_lock_bh(&rx_queue->input.lock);
+        skb_queue_splice_tail_init(&rx_queue->input, &rx_queue->process);
+        spin_unlock_bh(&rx_queue->input.lock);
+    }
+
+    return __skb_dequeue(&rx_queue->process);
+}
+
+static void dummy_rx_drained(struct net_device *dev, struct dummy_rx_queue *rx_queue) {
+    /* in case the queue has been drained under the wake threshold
+    the transmit queues stopped by it (congestion) are woken */
+    smp_mb();
+    if(!bitmap_empty(rx_queue->stopped, dev->num_tx_queues) &&
+        dummy_rx_pending(rx_queue) < DUMMY_RX_QUEUE_WAKE) {
+        dummy_tx_wake(dev, rx_queue);
+    }
+}
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+static int dummy_busy_poll(struct napi_struct *napi) {
+    struct dummy_rx_queue *rx_queue = container_of(napi, struct dummy_rx_queue, napi);
+    struct sk_buff *skb;
+    int done = 0;
+
+    /* the queue is owned either by the napi poll or by a busy
+    polling socket, in case it's owned by the napi poll (or the
+    device is going down) the socket has to try again later */
+    if(test_bit(NAPI_STATE_DISABLE, &napi->state)) { return LL_FLUSH_FAILED; }
+    if(test_and_set_bit(DUMMY_RX_POLL, &rx_queue->state)) { return LL_FLUSH_BUSY; }
+
+    /* receives a small number of frames directly in the context
+    of the socket, gro is bypassed as it would hold the frames */
+    while(done < DUMMY_BUSY_POLL_BUDGET) {
+        skb = dummy_rx_dequeue(rx_queue);
+        if(skb == NULL) { break; }
+        dummy_tx_account(rx_queue, skb);
+        netif_receive_skb(skb);
+        done++;
+    }
+
+    dummy_tx_complete(napi->dev, rx_queue);
+    dummy_rx_drained(napi->dev, rx_queue);
+    smp_mb__before_atomic();
+    clear_bit(DUMMY_RX_POLL, &rx_queue->state);
+    return done;
+}
+#endif
+
+static int dummy_poll(struct napi_struct *napi, int budget) {
+    struct dummy_rx_queue *rx_queue = container_of(napi, struct dummy_rx_queue, napi);
+    struct dummy_priv *priv = netdev_priv(napi->dev);
+    struct sk_buff *skb;
+    u32 flush_frames = ACCESS_ONCE(priv->gro_flush_frames);
+    int done = 0;
+
+    /* in case the queue is being busy polled by a socket the poll
+    yields (keeping the napi scheduled) until it's released */
+    if(test_and_set_bit(DUMMY_RX_POLL, &rx_queue->state)) { return budget; }
+
+    while(done < budget) {
+        skb = dummy_rx_dequeue(rx_queue);
+        if(skb == NULL) { break; }
+        dummy_tx_account(rx_queue, skb);
+
+        /* hands the frame to gro, so that consecutive segments
+        of the same flow are merged before protocol processing */
+        napi_gro_receive(napi, skb);
+        done++;
+
+        /* in case a flush interval is defined the held flows are
+        flushed every such number of frames, limiting the latency
+        introduced by gro on the (merged) frames */
+        if(flush_frames && done % flush_frames == 0) {
+            napi_gro_flush(napi, false);
+        }
+    }
+
+    dummy_tx_complete(napi->dev, rx_queue);
+    dummy_rx_drained(napi->dev, rx_queue);
+    smp_mb__before_atomic();
+    clear_bit(DUMMY_RX_POLL, &rx_queue->state);
+
+    /* in case the adaptive coalescing is enabled the rate of the
+    queue is sampled (once per poll) to adjust the coalescing */
+    if(ACCESS_ONCE(priv->coalesce.use_adaptive_rx_coalesce)) { dummy_rx_adapt(priv, rx_queue, done); }
+
+    /* in case the budget was not exhausted the polling is
+    completed (flushing gro), then the queue is verified
+    again to catch frames enqueued during the completion */
+    if(done < budget) {
+        napi_complete(napi);
+        if(!skb_queue_empty(&rx_queue->input)) { napi_reschedule(napi); }
+    }
+
+    return done;
+}
+
+static int dummy_rx_cpu(unsigned int index) {
+    unsigned int count = index % num_online_cpus();
+    int cpu;
+
+    for_each_online_cpu(cpu) {
+        if(count-- == 0) { return cpu; }
+    }
+
+    return cpumask_first(cpu_online_mask);
+}
+
+static void dummy_rss_init(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    unsigned int index;
+
+    /* generates a random key for the hash and distributes the
+    entries of the indirection table over the receive queues */
+    get_random_bytes(priv->rss_key, DUMMY_RSS_KEY_SIZE);
+    for(index = 0; index < DUMMY_RSS_INDIR_SIZE; index++) {
+        priv->rss_indir[index] = ethtool_rxfh_indir_default(index, dev->real_num_rx_queues);
+    }
+}
+
+static int dummy_get_rxnfc(struct net_device *dev, struct ethtool_rxnfc *info, u32 *rule_locs) {
+    switch(info->cmd) {
+        case ETHTOOL_GRXRINGS:
+            info->data = dev->real_num_rx_queues;
+            return 0;
+        default:
+            return -EOPNOTSUPP;
+    }
+}
+
+static u32 dummy_get_rxfh_key_size(struct net_device *dev) {
+    return DUMMY_RSS_KEY_SIZE;
+}
+
+static u32 dummy_get_rxfh_indir_size(struct net_device *dev) {
+    return DUMMY_RSS_INDIR_SIZE;
+}
+
+static int dummy_get_rxfh(struct net_device *dev, u32 *indir, u8 *key) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    unsigned int index;
+
+    if(indir != NULL) {
+        for(index = 0; index < DUMMY_RSS_INDIR_SIZE; index++) {
+            indir[index] = priv->rss_indir[index];
+        }
+    }
+    if(key != NULL) { memcpy(key, priv->rss_key, DUMMY_RSS_KEY_SIZE); }
+
+    return 0;
+}
+
+static int dummy_set_rxfh(struct net_device *dev, const u32 *indir, const u8 *key) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    unsigned int index;
+
+    /* updates the indirection table and the key, the values
+    are read without locking by the transmit path, a frame
+    may use a mix of the old and new values (same as a nic) */
+    if(indir != NULL) {
+        for(index = 0; index < DUMMY_RSS_INDIR_SIZE; index++) {
+            priv->rss_indir[index] = indir[index];
+        }
+    }
+    if(key != NULL) { memcpy(priv->rss_key, key, DUMMY_RSS_KEY_SIZE); }
+
+    return 0;
+}
+
+static int dummy_get_sset_count(struct net_device *dev, int sset) {
+    switch(sset) {
+        case ETH_SS_STATS:
+            return DUMMY_EVENT_COUNT;
+        default:
+            return -EOPNOTSUPP;
+    }
+}
+
+static void dummy_get_strings(struct net_device *dev, u32 stringset, u8 *data) {
+    if(stringset != ETH_SS_STATS) { return; }
+    memcpy(data, dummy_events, sizeof(dummy_events));
+}
+
+static void dummy_get_ethtool_stats(struct net_device *dev, struct ethtool_stats *stats, u64 *data) {
+    dummy_stats_events(dev, data);
+}
+
+static int dummy_get_coalesce(struct net_device *dev, struct ethtool_coalesce *coalesce) {
+    struct dummy_priv *priv = netdev_priv(dev);
+
+    *coalesce = priv->coalesce;
+    return 0;
+}
+
+static int dummy_set_coalesce(struct net_device *dev, struct ethtool_coalesce *coalesce) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_rx_queue *rx_queue;
+    unsigned int index;
+
+    /* verifies that the deadlines and the frame limits are in
+    the valid range (frames may not exceed the queue size) */
+    if(coalesce->rx_coalesce_usecs > DUMMY_COALESCE_MAX_USECS ||
+        coalesce->rx_coalesce_usecs_low > DUMMY_COALESCE_MAX_USECS ||
+        coalesce->rx_coalesce_usecs_high > DUMMY_COALESCE_MAX_USECS) { return -EINVAL; }
+    if(coalesce->rx_max_coalesced_frames > DUMMY_RX_QUEUE_STOP ||
+        coalesce->rx_max_coalesced_frames_low > DUMMY_RX_QUEUE_STOP ||
+        coalesce->rx_max_coalesced_frames_high > DUMMY_RX_QUEUE_STOP) { return -EINVAL; }
+
+    /* stores the (receive) values and applies them to each of
+    the queues, the adaptive mode adjusts them on the next poll */
+    priv->coalesce.rx_coalesce_usecs = coalesce->rx_coalesce_usecs;
+    priv->coalesce.rx_max_coalesced_frames = coalesce->rx_max_coalesced_frames;
+    priv->coalesce.rx_coalesce_usecs_low = coalesce->rx_coalesce_usecs_low;
+    priv->coalesce.rx_max_coalesced_frames_low = coalesce->rx_max_coalesced_frames_low;
+    priv->coalesce.rx_coalesce_usecs_high = coalesce->rx_coalesce_usecs_high;
+    priv->coalesce.rx_max_coalesced_frames_high = coalesce->rx_max_coalesced_frames_high;
+    priv->coalesce.pkt_rate_low = coalesce->pkt_rate_low;
+    priv->coalesce.pkt_rate_high = coalesce->pkt_rate_high;
+    priv->coalesce.use_adaptive_rx_coalesce = coalesce->use_adaptive_rx_coalesce;
+
+    for(index = 0; index < dev->num_rx_queues; index++) {
+        rx_queue = &priv->rx_queues[index];
+        ACCESS_ONCE(rx_queue->usecs) = coalesce->rx_coalesce_usecs;
+        ACCESS_ONCE(rx_queue->frames) = coalesce->rx_max_coalesced_frames;
+    }
+
+    return 0;
+}
+
+static unsigned int dummy_get_num_queues(void) {
+    return num_queues;
+}
+
+static int dummy_rx_alloc(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_rx_queue *rx_queue;
+    unsigned int index;
+
+    priv->rx_queues = kcalloc(dev->num_rx_queues, sizeof(struct dummy_rx_queue), GFP_KERNEL);
+    if(!priv->rx_queues) { return -ENOMEM; }
+
+    /* allocates the bitmaps of the transmit queues stopped by
+    each of the receive queues (congestion), so that only these
+    are woken once the receive queue is drained, and the state
+    of the completions of the transmit queues (byte queue limits) */
+    for(index = 0; index < dev->num_rx_queues; index++) {
+        rx_queue = &priv->rx_queues[index];
+        rx_queue->stopped = kcalloc(BITS_TO_LONGS(dev->num_tx_queues), sizeof(unsigned long), GFP_KERNEL);
+        rx_queue->completed = kcalloc(BITS_TO_LONGS(dev->num_tx_queues), sizeof(unsigned long), GFP_KERNEL);
+        rx_queue->completions = kcalloc(dev->num_tx_queues, sizeof(struct dummy_tx_completion), GFP_KERNEL);
+        if(rx_queue->stopped && rx_queue->completed && rx_queue->completions) { continue; }
+        do {
+            kfree(priv->rx_queues[index].stopped);
+            kfree(priv->rx_queues[index].completed);
+            kfree(priv->rx_queues[index].completions);
+        } while(index-- > 0);
+        kfree(priv->rx_queues);
+        priv->rx_queues = NULL;
+        return -ENOMEM;
+    }
+
+    /* initializes each of the receive queues and registers
+    their napi contexts (only enabled when the device opens) */
+    for(index = 0; index < dev->num_rx_queues; index++) {
+        rx_queue = &priv->rx_queues[index];
+        rx_queue->index = index;
+        rx_queue->csd.func = dummy_rx_kick;
+        rx_queue->csd.info = rx_queue;
+        hrtimer_init(&rx_queue->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+        rx_queue->timer.function = dummy_rx_timer;
+        skb_queue_head_init(&rx_queue->input);
+        __skb_queue_head_init(&rx_queue->process);
+        netif_napi_add(dev, &rx_queue->napi, dummy_poll, NAPI_POLL_WEIGHT);
+        napi_hash_add(&rx_queue->napi);
+    }
+
+    return 0;
+}
+
+static void dummy_rx_free(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    unsigned int index;
+
+    if(priv->rx_queues == NULL) { return; }
+
+    /* removes the napi contexts from the (busy poll) hash, the
+    contexts may be in use by readers of the hash until the end
+    of the grace period, only then they may be released */
+    for(index = 0; index < dev->num_rx_queues; index++) {
+        napi_hash_del(&priv->rx_queues[index].napi);
+    }
+    synchronize_net();
+
+    for(index = 0; index < dev->num_rx_queues; index++) {
+        netif_napi_del(&priv->rx_queues[index].napi);
+        kfree(priv->rx_queues[index].stopped);
+        kfree(priv->rx_queues[index].completed);
+        kfree(priv->rx_queues[index].completions);
+    }
+
+    kfree(priv->rx_queues);
+    priv->rx_queues = NULL;
+}
+
+static void dummy_bench_addresses(struct net_device *dev, __be32 *source, __be32 *destination) {
+    struct in_device *in_dev;
+
+    /* the frames are sent from the (first) address of the device
+    to its peer (address with the last bit flipped) as the stack
+    would do, in case there's no address the benchmark range is used */
+    *source = htonl(DUMMY_BENCH_ADDRESS);
+    rcu_read_lock();
+    in_dev = __in_dev_get_rcu(dev);
+    if(in_dev != NULL && in_dev->ifa_list != NULL) { *source = in_dev->ifa_list->ifa_local; }
+    rcu_read_unlock();
+    *destination = *source ^ htonl(1);
+}
+
+static int dummy_bench_run(void *data) {
+    struct net_device *dev = data;
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_bench_stats *stats;
+    struct netdev_queue *txq;
+    struct sk_buff *skb;
+    unsigned char frames[BENCH_KINDS][BENCH_FRAME_SIZE];
+    unsigned int sizes[BENCH_KINDS];
+    unsigned char peer_mac[MAC_ADDRESS_SIZE];
+    unsigned long count = 0;
+    unsigned int kind = 0;
+    __be32 source;
+    __be32 destination;
+    u64 next = 0;
+    u64 start;
+    u64 now;
+    u32 rate;
+    u32 mask;
+    u16 queue;
+    u8 responder;
+    int cpu = smp_processor_id();
+
+    /* prebuilds the frames of each of the kinds, these are only
+    copied into the new buffers (no build cost per frame) */
+    dummy_bench_addresses(dev, &source, &destination);
+    eth_random_addr(peer_mac);
+    for(kind = 0; kind < BENCH_KINDS; kind++) {
+        sizes[kind] = bench_frame_c(frames[kind], kind, dev->dev_addr, peer_mac, source, destination);
+    }
+
+    queue = cpu % dev->real_num_tx_queues;
+    txq = netdev_get_tx_queue(dev, queue);
+    stats = per_cpu_ptr(priv->bench->stats, cpu);
+
+    while(!kthread_should_stop()) {
+        if(++count % DUMMY_BENCH_BATCH == 0) { cond_resched(); }
+
+        /* selects the next kind of frame from the enabled ones
+        (round robin), in case none is enabled the thread waits */
+        mask = ACCESS_ONCE(priv->bench_mask) & ((1 << BENCH_KINDS) - 1);
+        if(mask == 0) { msleep_interruptible(100); continue; }
+        do { kind = (kind + 1) % BENCH_KINDS; } while(!(mask & (1 << kind)));
+
+        /* in case a rate is defined (per thread) the frames are
+        paced, sleeping for long waits and spinning for short ones */
+        rate = ACCESS_ONCE(priv->bench_rate);
+        if(rate != 0) {
+            now = local_clock();
+            if(next > now + DUMMY_BENCH_SPIN_NS) {
+                usleep_range((next - now) / NSEC_PER_USEC, (next - now) / NSEC_PER_USEC + 10);
+            }
+            while(local_clock() < next) { cpu_relax(); }
+            next = max(next, now) + NSEC_PER_SEC / rate;
+        }
+
+        skb = netdev_alloc_skb(dev, sizes[kind]);
+        if(skb == NULL) { cond_resched(); continue; }
+        memcpy(skb_put(skb, sizes[kind]), frames[kind], sizes[kind]);
+        skb_set_queue_mapping(skb, queue);
+
+        /* injects the frame in the transmit path (as the stack does
+        for the queue of the cpu) respecting the flow control of the
+        queue, only the time spent in the driver is measured */
+        local_bh_disable();
+        __netif_tx_lock(txq, cpu);
+        if(unlikely(netif_xmit_stopped(txq))) {
+            __netif_tx_unlock(txq);
+            local_bh_enable();
+            kfree_skb(skb);
+            stats->stopped++;
+            cond_resched();
+            continue;
+        }
+        start = local_clock();
+        responder = dummy_xmit_r(skb, dev);
+        now = local_clock();
+        __netif_tx_unlock(txq);
+        local_bh_enable();
+
+        /* accounts the frame under the responder that actually
+        answered it (none in case it was not answered) */
+        stats->frames[kind][responder]++;
+        stats->ns[kind][responder] += now - start;
+    }
+
+    return 0;
+}
+
+static void dummy_bench_stop(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_bench *bench = priv->bench;
+    int cpu;
+
+    ASSERT_RTNL();
+    lockdep_assert_held(&priv->bench_mutex);
+
+    if(bench == NULL) { return; }
+
+    for_each_possible_cpu(cpu) {
+        if(bench->threads[cpu] == NULL) { continue; }
+        kthread_stop(bench->threads[cpu]);
+        bench->threads[cpu] = NULL;
+    }
+
+    if(bench->running) { bench->end = local_clock(); }
+    bench->running = false;
+}
+
+static int dummy_bench_start(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_bench *bench = priv->bench;
+    struct task_struct *thread;
+    int cpu;
+
+    ASSERT_RTNL();
+    lockdep_assert_held(&priv->bench_mutex);
+
+    if(!netif_running(dev)) { return -ENETDOWN; }
+    if(bench != NULL && bench->running) { return -EBUSY; }
+
+    /* allocates the state of the benchmark on its first run, the
+    state is kept (results) until the device is released */
+    if(bench == NULL) {
+        bench = kzalloc(sizeof(struct dummy_bench), GFP_KERNEL);
+        if(bench == NULL) { return -ENOMEM; }
+        bench->threads = kcalloc(nr_cpu_ids, sizeof(struct task_struct *), GFP_KERNEL);
+        bench->stats = alloc_percpu(struct dummy_bench_stats);
+        if(bench->threads == NULL || bench->stats == NULL) {
+            free_percpu(bench->stats);
+            kfree(bench->threads);
+            kfree(bench);
+            return -ENOMEM;
+        }
+        priv->bench = bench;
+    }
+
+    for_each_possible_cpu(cpu) {
+        memset(per_cpu_ptr(bench->stats, cpu), 0, sizeof(struct dummy_bench_stats));
+    }
+    bench->start = local_clock();
+    bench->end = 0;
+    bench->running = true;
+
+    /* creates one thread per online cpu (bound to it), each of
+    them injecting frames into the transmit queue of the cpu */
+    for_each_online_cpu(cpu) {
+        thread = kthread_create_on_node(dummy_bench_run, dev, cpu_to_node(cpu), "dummy_bench/%d", cpu);
+        if(IS_ERR(thread)) { dummy_bench_stop(dev); return PTR_ERR(thread); }
+        kthread_bind(thread, cpu);
+        bench->threads[cpu] = thread;
+        wake_up_process(thread);
+    }
+
+    return 0;
+}
+
+static void dummy_bench_free(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+
+    if(priv->bench == NULL) { return; }
+
+    free_percpu(priv->bench->stats);
+    kfree(priv->bench->threads);
+    kfree(priv->bench);
+    priv->bench = NULL;
+}
+
+static int dummy_bench_show(struct seq_file *file, void *data) {
+    static const char *kinds[BENCH_KINDS] = { "arp", "icmp", "udp" };
+    static const char *responders[DUMMY_RESPONDER_COUNT] = {
+        "none", "arp", "ip", "ipv6", "multicast", "custom", "dns", "canned"
+    };
+    struct net_device *dev = file->private;
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_bench_stats *stats;
+    struct dummy_bench *bench;
+    unsigned int kind;
+    unsigned int responder;
+    u64 frames;
+    u64 ns;
+    u64 stopped = 0;
+    u64 elapsed;
+    int cpu;
+
+    /* the state of the benchmark is only guarded by the lock of
+    the benchmark of the device (not the rtnl lock), the counters
+    themselves are read without locking (per cpu) */
+    mutex_lock(&priv->bench_mutex);
+    bench = priv->bench;
+    if(bench == NULL) { mutex_unlock(&priv->bench_mutex); return 0; }
+
+    /* the rates are relative to the (wall clock) duration of the
+    run and include the receive of the responses, while the time
+    per frame only includes the time spent in the transmit path */
+    elapsed = (bench->running ? local_clock() : bench->end) - bench->start;
+    seq_printf(file, "%s %llu ns\n", bench->running ? "running" : "stopped", elapsed);
+    seq_printf(file, "kind responder frames ns/frame pps\n");
+
+    for_each_possible_cpu(cpu) {
+        stopped += ACCESS_ONCE(per_cpu_ptr(bench->stats, cpu)->stopped);
+    }
+
+    /* prints one line per kind of frame and responder that answered
+    it (as recorded per frame), skipping the ones without frames */
+    for(kind = 0; kind < BENCH_KINDS; kind++) {
+        for(responder = 0; responder < DUMMY_RESPONDER_COUNT; responder++) {
+            frames = 0;
+            ns = 0;
+            for_each_possible_cpu(cpu) {
+                stats = per_cpu_ptr(bench->stats, cpu);
+                frames += ACCESS_ONCE(stats->frames[kind][responder]);
+                ns += ACCESS_ONCE(stats->ns[kind][responder]);
+            }
+            if(frames == 0) { continue; }
+            seq_printf(
+                file,
+                "%s %s %llu %llu %llu\n",
+                kinds[kind],
+                responders[responder],
+                frames,
+                div64_u64(ns, frames),
+                elapsed ? div64_u64(frames * NSEC_PER_SEC, elapsed) : 0
+            );
+        }
+    }
+
+    seq_printf(file, "stopped %llu\n", stopped);
+    mutex_unlock(&priv->bench_mutex);
+    return 0;
+}
+
+static int dummy_bench_open(struct inode *inode, struct file *file) {
+    return single_open(file, dummy_bench_show, inode->i_private);
+}
+
+static ssize_t dummy_bench_write(struct file *file, const char __user *buffer, size_t count, loff_t *position) {
+    struct net_device *dev = ((struct seq_file *) file->private_data)->private;
+    struct dummy_priv *priv = netdev_priv(dev);
+    unsigned int value;
+    int error;
+
+    error = kstrtouint_from_user(buffer, count, 0, &value);
+    if(error) { return error; }
+
+    /* starts (non zero) or stops (zero) the benchmark, under
+    the rtnl lock so that the device is not closed meanwhile and
+    under the lock of the benchmark as its state is changed */
+    rtnl_lock();
+    mutex_lock(&priv->bench_mutex);
+    if(value) { error = dummy_bench_start(dev); } else { dummy_bench_stop(dev); }
+    mutex_unlock(&priv->bench_mutex);
+    rtnl_unlock();
+
+    return error ? error : count;
+}
+
+static const struct file_operations dummy_bench_fops = {
+    .owner = THIS_MODULE,
+    .open = dummy_bench_open,
+    .read = seq_read,
+    .write = dummy_bench_write,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static void dummy_mirror(struct sk_buff *skb, struct net_device *dev, u32 mode) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct net_device *mirror;
+    struct sk_buff *skb_clone;
+
+    /* runs under the rcu (bh) read lock of the transmit path, so
+    the mirror device remains valid until the end of the call */
+    mirror = rcu_dereference_bh(priv->mirror);
+    if(likely(mirror == NULL)) { return; }
+    if(!(ACCESS_ONCE(priv->mirror_mode) & mode)) { return; }
+    if(!netif_running(mirror)) { return; }
+
+    /* the clone shares the data (headers and pages) of the frame,
+    only the metadata is allocated, so no data is copied */
+    skb_clone = skb_clone(skb, GFP_ATOMIC);
+    if(skb_clone == NULL) { dummy_stats_event(dev, DUMMY_EVENT_NO_MEMORY); return; }
+
+    skb_scrub_packet(skb_clone, true);
+    skb_clone->dev = mirror;
+    if(dev_queue_xmit(skb_clone) != NET_XMIT_SUCCESS) {
+        dummy_stats_event(dev, DUMMY_EVENT_MIRROR_DROP);
+    }
+}
+
+static int dummy_mirror_set(struct net_device *dev, struct net_device *mirror) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_priv *next_priv;
+    struct net_device *previous;
+    struct net_device *next = mirror;
+
+    /* verifies that the mirroring doesn't form a loop, in which
+    a mirrored frame would be mirrored back to the device, the
+    chain of (dummy) mirror devices is followed to its end */
+    while(next != NULL) {
+        if(next == dev) { return -ELOOP; }
+        if(next->netdev_ops != &dummy_netdev_ops) { break; }
+        next_priv = netdev_priv(next);
+        next = rtnl_dereference(next_priv->mirror);
+    }
+
+    previous = rtnl_dereference(priv->mirror);
+    if(previous == mirror) { return 0; }
+
+    /* publishes the new mirror device and only releases the
+    previous one after the transmit paths using it are done */
+    if(mirror != NULL) { dev_hold(mirror); }
+    rcu_assign_pointer(priv->mirror, mirror);
+    if(previous != NULL) {
+        synchronize_net();
+        dev_put(previous);
+    }
+
+    return 0;
+}
+
+static int dummy_mirror_show(struct seq_file *file, void *data) {
+    struct net_device *dev = file->private;
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct net_device *mirror;
+
+    rtnl_lock();
+    mirror = rtnl_dereference(priv->mirror);
+    if(mirror != NULL) { seq_printf(file, "%s\n", mirror->name); }
+    rtnl_unlock();
+    return 0;
+}
+
+static int dummy_mirror_open(struct inode *inode, struct file *file) {
+    return single_open(file, dummy_mirror_show, inode->i_private);
+}
+
+static ssize_t dummy_mirror_write(struct file *file, const char __user *buffer, size_t count, loff_t *position) {
+    struct net_device *dev = ((struct seq_file *) file->private_data)->private;
+    struct net_device *mirror = NULL;
+    char name[IFNAMSIZ];
+    size_t size = min(count, sizeof(name) - 1);
+    int error = 0;
+
+    if(copy_from_user(name, buffer, size)) { return -EFAULT; }
+    name[size] = '\0';
+    strim(name);
+
+    /* resolves the mirror device by its name (in the namespace of
+    the device), an empty name stops the mirroring of the device */
+    rtnl_lock();
+    if(name[0] != '\0') {
+        mirror = __dev_get_by_name(dev_net(dev), name);
+        if(mirror == NULL) {
+            error = -ENODEV;
+        } else if(mirror->type != ARPHRD_ETHER) {
+            error = -EINVAL;
+        }
+    }
+    if(!error) { error = dummy_mirror_set(dev, mirror); }
+    rtnl_unlock();
+
+    return error ? error : count;
+}
+
+static const struct file_operations dummy_mirror_fops = {
+    .owner = THIS_MODULE,
+    .open = dummy_mirror_open,
+    .read = seq_read,
+    .write = dummy_mirror_write,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static void dummy_mirror_release(struct net_device *target) {
+    struct dummy_priv *priv;
+    struct net_device *dev;
+
+    /* stops the mirroring of any device to the one that is being
+    unregistered (or moved to another namespace) and the mirroring
+    of the device itself, releasing the references to the mirrors */
+    for_each_netdev(dev_net(target), dev) {
+        if(dev->netdev_ops != &dummy_netdev_ops) { continue; }
+        priv = netdev_priv(dev);
+        if(dev != target && rtnl_dereference(priv->mirror) != target) { continue; }
+        dummy_mirror_set(dev, NULL);
+    }
+}
+
+static int dummy_xmit_f(struct sk_buff *skb, struct net_device *dev, struct net_device *peer) {
+    struct dummy_priv *priv = netdev_priv(dev);
+
+    /* the frame is no longer accounted to the socket that sent it
+    (as in any transmission) and it's dropped in case the peer is
+    not running or can't take it (larger than its mtu) */
+    skb_orphan(skb);
+    if(unlikely(!netif_running(peer) || !is_skb_forwardable(peer, skb) || !pskb_may_pull(skb, ETH_HLEN))) {
+        dummy_stats_event(dev, DUMMY_EVENT_PEER_DROP);
+        kfree_skb(skb);
+        return NET_RX_DROP;
+    }
+
+    /* rewrites the mac addresses (in case it's requested) from the
+    device to the peer, as a router would do, so that no neighbor
+    resolution is required, on a private copy of the header */
+    if(ACCESS_ONCE(priv->peer_rewrite)) {
+        if(skb_cow_head(skb, 0)) {
+            dummy_stats_event(dev, DUMMY_EVENT_NO_MEMORY);
+            kfree_skb(skb);
+            return NET_RX_DROP;
+        }
+        memcpy(&(skb->data[0]), peer->dev_addr, MAC_ADDRESS_SIZE);
+        memcpy(&(skb->data[MAC_ADDRESS_SIZE]), dev->dev_addr, MAC_ADDRESS_SIZE);
+    }
+
+    /* scrubs the state of the transmission path, including the
+    owner and the mark in case the peer is in another namespace */
+    skb_scrub_packet(skb, !net_eq(dev_net(dev), dev_net(peer)));
+
+    if(skb->ip_summed == CHECKSUM_NONE && peer->features & NETIF_F_RXCSUM) {
+        skb->ip_summed = CHECKSUM_UNNECESSARY;
+    }
+
+    /* hands the frame itself over to the receive queue of the peer
+    (the one paired with the transmit queue of the frame) with no
+    allocation nor copy, as for the reflected frames */
+    skb->protocol = eth_type_trans(skb, peer);
+    dummy_rss_hash(skb, peer);
+    DUMMY_SKB_CB(skb)->bytes = 0;
+    return dummy_rx_enqueue(skb, peer, false);
+}
+
+static int dummy_peer_link(struct net_device *dev, struct net_device *peer) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_priv *peer_priv;
+
+    if(peer == dev || peer->netdev_ops != &dummy_netdev_ops) { return -EINVAL; }
+    if(rtnl_dereference(priv->peer) == peer) { return 0; }
+
+    /* removes the previous links of both of the devices, so that
+    a device is always linked with (at most) one peer */
+    dummy_peer_unlink(dev);
+    dummy_peer_unlink(peer);
+
+    /* each of the devices holds a reference to its peer, that is
+    only released once the link is removed (eg: unregister) */
+    peer_priv = netdev_priv(peer);
+    dev_hold(peer);
+    dev_hold(dev);
+    rcu_assign_pointer(priv->peer, peer);
+    rcu_assign_pointer(peer_priv->peer, dev);
+
+    return 0;
+}
+
+static void dummy_peer_unlink(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_priv *peer_priv;
+    struct net_device *peer;
+
+    peer = rtnl_dereference(priv->peer);
+    if(peer == NULL) { return; }
+
+    /* removes the link in both directions and only releases the
+    references after the transmit paths using them are done */
+    peer_priv = netdev_priv(peer);
+    RCU_INIT_POINTER(priv->peer, NULL);
+    RCU_INIT_POINTER(peer_priv->peer, NULL);
+    synchronize_net();
+    dev_put(peer);
+    dev_put(dev);
+}
+
+static int dummy_peer_show(struct seq_file *file, void *data) {
+    struct net_device *dev = file->private;
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct net_device *peer;
+
+    /* the peer may be in another namespace (moved after the link)
+    so its namespace is shown together with its name */
+    rtnl_lock();
+    peer = rtnl_dereference(priv->peer);
+    if(peer != NULL) { seq_printf(file, "%s net%u\n", peer->name, dev_net(peer)->proc_inum); }
+    rtnl_unlock();
+    return 0;
+}
+
+static int dummy_peer_open(struct inode *inode, struct file *file) {
+    return single_open(file, dummy_peer_show, inode->i_private);
+}
+
+static ssize_t dummy_peer_write(struct file *file, const char __user *buffer, size_t count, loff_t *position) {
+    struct net_device *dev = ((struct seq_file *) file->private_data)->private;
+    struct net_device *peer;
+    char name[IFNAMSIZ];
+    size_t size = min(count, sizeof(name) - 1);
+    int error = 0;
+
+    if(copy_from_user(name, buffer, size)) { return -EFAULT; }
+    name[size] = '\0';
+    strim(name);
+
+    /* resolves the peer (dummy) device by its name in the namespace
+    of the device, an empty name removes the link of the device */
+    rtnl_lock();
+    if(name[0] == '\0') {
+        dummy_peer_unlink(dev);
+    } else {
+        peer = __dev_get_by_name(dev_net(dev), name);
+        error = peer ? dummy_peer_link(dev, peer) : -ENODEV;
+    }
+    rtnl_unlock();
+
+    return error ? error : count;
+}
+
+static const struct file_operations dummy_peer_fops = {
+    .owner = THIS_MODULE,
+    .open = dummy_peer_open,
+    .read = seq_read,
+    .write = dummy_peer_write,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static void dummy_export_publish(struct dummy_stats_export *export) {
+    struct dummy_stats_header *header = export->header;
+    struct dummy_priv *priv = netdev_priv(export->dev);
+    struct dummy_stats_counters *counters;
+    struct dummy_stats_counters total;
+    const struct pcpu_dstats *dstats;
+    unsigned int start;
+    unsigned int event;
+    int cpu;
+
+    /* starts with the compact counters (zero unless the compact
+    mode is in use), the per cpu ones are added to them */
+    total.rx_packets = atomic64_read(&priv->cstats.rx_packets);
+    total.tx_packets = atomic64_read(&priv->cstats.tx_packets);
+    total.rx_bytes = atomic64_read(&priv->cstats.rx_bytes);
+    total.tx_bytes = atomic64_read(&priv->cstats.tx_bytes);
+    for(event = 0; event < DUMMY_EVENT_COUNT; event++) {
+        total.events[event] = atomic64_read(&priv->cstats.events[event]);
+    }
+
+    /* the page has a single writer (the work) so the sequence is
+    simply made odd while the counters are being written */
+    header->sequence++;
+    smp_wmb();
+
+    if(export->dev->dstats != NULL) {
+        for_each_possible_cpu(cpu) {
+            dstats = per_cpu_ptr(export->dev->dstats, cpu);
+            counters = &header->cpu[cpu];
+            do {
+                start = u64_stats_fetch_begin(&dstats->syncp);
+                counters->rx_packets = dstats->rx_packets;
+                counters->tx_packets = dstats->tx_packets;
+                counters->rx_bytes = dstats->rx_bytes;
+                counters->tx_bytes = dstats->tx_bytes;
+                memcpy(counters->events, dstats->events, sizeof(counters->events));
+            } while(u64_stats_fetch_retry(&dstats->syncp, start));
+
+            total.rx_packets += counters->rx_packets;
+            total.tx_packets += counters->tx_packets;
+            total.rx_bytes += counters->rx_bytes;
+            total.tx_bytes += counters->tx_bytes;
+            for(event = 0; event < DUMMY_EVENT_COUNT; event++) {
+                total.events[event] += counters->events[event];
+            }
+        }
+    }
+
+    header->total = total;
+    header->timestamp = ktime_to_ns(ktime_get());
+    header->usecs = ACCESS_ONCE(priv->stats_usecs);
+    header->publications++;
+
+    smp_wmb();
+    header->sequence++;
+}
+
+static void dummy_export_work(struct work_struct *work) {
+    struct dummy_stats_export *export = container_of(work, struct dummy_stats_export, work.work);
+    struct dummy_priv *priv = netdev_priv(export->dev);
+    u32 usecs = max_t(u32, ACCESS_ONCE(priv->stats_usecs), DUMMY_STATS_MIN_USECS);
+
+    /* publishes the page from process context (work queue) as
+    the per cpu counters are read with their sync, which may have
+    to wait for a writer, and all of the cpus are walked */
+    dummy_export_publish(export);
+    schedule_delayed_work(&export->work, usecs_to_jiffies(usecs));
+}
+
+static int dummy_export_open(struct inode *inode, struct file *file) {
+    struct net_device *dev = inode->i_private;
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_stats_export *export;
+    struct dummy_stats_header *header;
+
+    /* the page is shared by all of the openings of the file and
+    is only allocated (and published) while there's one of them */
+    mutex_lock(&dummy_export_mutex);
+    export = priv->stats_export;
+    if(export == NULL) {
+        export = kzalloc(sizeof(struct dummy_stats_export), GFP_KERNEL);
+        if(export == NULL) { mutex_unlock(&dummy_export_mutex); return -ENOMEM; }
+        export->size = PAGE_ALIGN(sizeof(struct dummy_stats_header) +
+            nr_cpu_ids * sizeof(struct dummy_stats_counters));
+        export->header = vmalloc_user(export->size);
+        if(export->header == NULL) {
+            kfree(export);
+            mutex_unlock(&dummy_export_mutex);
+            return -ENOMEM;
+        }
+
+        header = export->header;
+        header->magic = DUMMY_STATS_MAGIC;
+        header->version = DUMMY_STATS_VERSION;
+        header->cpus = nr_cpu_ids;
+        header->events = DUMMY_EVENT_COUNT;
+        export->dev = dev;
+        dummy_export_publish(export);
+
+        INIT_DELAYED_WORK(&export->work, dummy_export_work);
+        schedule_delayed_work(&export->work, 0);
+        priv->stats_export = export;
+    }
+    export->users++;
+    file->private_data = export;
+    mutex_unlock(&dummy_export_mutex);
+
+    return nonseekable_open(inode, file);
+}
+
+static int dummy_export_mmap(struct file *file, struct vm_area_struct *vma) {
+    struct dummy_stats_export *export = file->private_data;
+
+    /* the mapping must be read only as the page is only meant
+    to be written by the (work of the) driver, it may not be made
+    writable later either (mprotect) */
+    if(vma->vm_flags & VM_WRITE) { return -EPERM; }
+    vma->vm_flags &= ~VM_MAYWRITE;
+    return remap_vmalloc_range(vma, export->header, vma->vm_pgoff);
+}
+
+static void dummy_export_stop(struct dummy_stats_export *export) {
+    struct dummy_priv *priv;
+
+    /* stops the publication and detaches the page from the device,
+    the page itself remains valid (mapped) until it's released */
+    if(export->dev == NULL) { return; }
+    cancel_delayed_work_sync(&export->work);
+    priv = netdev_priv(export->dev);
+    priv->stats_export = NULL;
+    export->dev = NULL;
+}
+
+static int dummy_export_release(struct inode *inode, struct file *file) {
+    struct dummy_stats_export *export = file->private_data;
+
+    /* the pages of the mapping are referenced by the mapping so
+    they remain valid for userspace after the release of the page */
+    mutex_lock(&dummy_export_mutex);
+    if(--export->users == 0) {
+        dummy_export_stop(export);
+        vfree(export->header);
+        kfree(export);
+    }
+    mutex_unlock(&dummy_export_mutex);
+    return 0;
+}
+
+static const struct file_operations dummy_export_fops = {
+    .owner = THIS_MODULE,
+    .open = dummy_export_open,
+    .mmap = dummy_export_mmap,
+    .release = dummy_export_release,
+};
+
+static void dummy_debugfs_init(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dentry *root = dummy_net(dev)->debugfs;
+
+    /* creates the directory of the device (under the directory of
+    its namespace) with the tunable values, a failure is not fatal
+    (no tuning available) */
+    if(root == NULL) { return; }
+    priv->debugfs = debugfs_create_dir(dev->name, root);
+    if(IS_ERR_OR_NULL(priv->debugfs)) { priv->debugfs = NULL; return; }
+
+    debugfs_create_u32("gro_flush_frames", 0644, priv->debugfs, &priv->gro_flush_frames);
+    debugfs_create_u32("capture_rate", 0644, priv->debugfs, &priv->capture_rate);
+    debugfs_create_u32("rss_hash", 0644, priv->debugfs, &priv->rss_hash);
+    debugfs_create_u32("rss_steer", 0644, priv->debugfs, &priv->rss_steer);
+    debugfs_create_u32("fanout", 0644, priv->debugfs, &priv->fanout);
+    debugfs_create_u32("sketch", 0644, priv->debugfs, &priv->sketch);
+    debugfs_create_u32("rx_timestamp", 0644, priv->debugfs, &priv->rx_timestamp);
+    debugfs_create_u32("bench_rate", 0644, priv->debugfs, &priv->bench_rate);
+    debugfs_create_u32("bench_mask", 0644, priv->debugfs, &priv->bench_mask);
+    debugfs_create_file("bench", 0600, priv->debugfs, dev, &dummy_bench_fops);
+    debugfs_create_u32("mirror_mode", 0644, priv->debugfs, &priv->mirror_mode);
+    debugfs_create_file("mirror", 0600, priv->debugfs, dev, &dummy_mirror_fops);
+    debugfs_create_u32("peer_rewrite", 0644, priv->debugfs, &priv->peer_rewrite);
+    debugfs_create_file("peer", 0600, priv->debugfs, dev, &dummy_peer_fops);
+    debugfs_create_u32("stats_usecs", 0644, priv->debugfs, &priv->stats_usecs);
+    debugfs_create_file("stats_page", 0400, priv->debugfs, dev, &dummy_export_fops);
+}
+
+static void dummy_debugfs_remove(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+
+    debugfs_remove_recursive(priv->debugfs);
+    priv->debugfs = NULL;
+}
+
+static int dummy_netdev_event(struct notifier_block *notifier, unsigned long event, void *data) {
+    struct net_device *dev = netdev_notifier_info_to_dev(data);
+    bool dummy = dev->netdev_ops == &dummy_netdev_ops;
+
+    /* the debugfs directory of a device follows the device, being
+    created once it's registered in a namespace (also after being
+    moved) and removed once it leaves it, a rename re-creates it */
+    switch(event) {
+        case NETDEV_REGISTER:
+            if(dummy) { dummy_debugfs_init(dev); }
+            break;
+
+        case NETDEV_CHANGENAME:
+            if(dummy) { dummy_debugfs_remove(dev); dummy_debugfs_init(dev); }
+            break;
+
+        case NETDEV_UNREGISTER:
+            if(dummy) { dummy_debugfs_remove(dev); }
+            dummy_mirror_release(dev);
+
+            /* the link with the peer is only removed once the device
+            is really unregistered, a device moved to another namespace
+            keeps its peer (pairs across namespaces) */
+            if(dummy && dev->reg_state == NETREG_UNREGISTERING) { dummy_peer_unlink(dev); }
+            break;
+    }
+
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block dummy_notifier = {
+    .notifier_call = dummy_netdev_event,
+};
+
+static int dummy_net_show(struct seq_file *file, void *data) {
+    struct net *net = file->private;
+    struct rtnl_link_stats64 storage;
+    struct rtnl_link_stats64 stats;
+    struct net_device *dev;
+    u64 events[DUMMY_EVENT_COUNT];
+    u64 total[DUMMY_EVENT_COUNT];
+    unsigned int devices = 0;
+    unsigned int index;
+
+    memset(&stats, 0, sizeof(stats));
+    memset(total, 0, sizeof(total));
+
+    /* sums the statistics of all of the devices of the namespace,
+    under the rtnl lock so that the devices remain registered */
+    rtnl_lock();
+    for_each_netdev(net, dev) {
+        if(dev->netdev_ops != &dummy_netdev_ops) { continue; }
+        memset(&storage, 0, sizeof(storage));
+        dev_get_stats(dev, &storage);
+        stats.rx_packets += storage.rx_packets;
+        stats.tx_packets += storage.tx_packets;
+        stats.rx_bytes += storage.rx_bytes;
+        stats.tx_bytes += storage.tx_bytes;
+        dummy_stats_events(dev, events);
+        for(index = 0; index < DUMMY_EVENT_COUNT; index++) { total[index] += events[index]; }
+        devices++;
+    }
+    rtnl_unlock();
+
+    seq_printf(file, "devices %u\n", devices);
+    seq_printf(file, "rx_packets %llu\ntx_packets %llu\n", stats.rx_packets, stats.tx_packets);
+    seq_printf(file, "rx_bytes %llu\ntx_bytes %llu\n", stats.rx_bytes, stats.tx_bytes);
+    for(index = 0; index < DUMMY_EVENT_COUNT; index++) {
+        seq_printf(file, "%s %llu\n", dummy_events[index], total[index]);
+    }
+    return 0;
+}
+
+static int dummy_net_open(struct inode *inode, struct file *file) {
+    return single_open(file, dummy_net_show, inode->i_private);
+}
+
+static const struct file_operations dummy_net_fops = {
+    .owner = THIS_MODULE,
+    .open = dummy_net_open,
+    .read = seq_read,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+static int __net_init dummy_net_init(struct net *net) {
+    struct dummy_net *state = net_generic(net, dummy_net_id);
+    char name[16];
+    int error;
+
+    /* the initial namespace uses the root directory of the module
+    (as before namespaces were supported), the other ones have their
+    own directory named after the (inode) number of the namespace */
+    if(net == &init_net) {
+        state->debugfs = dummy_debugfs;
+    } else if(dummy_debugfs != NULL) {
+        snprintf(name, sizeof(name), "net%u", net->proc_inum);
+        state->debugfs = debugfs_create_dir(name, dummy_debugfs);
+        if(IS_ERR_OR_NULL(state->debugfs)) { state->debugfs = NULL; }
+    }
+
+    if(state->debugfs != NULL) {
+        state->stats = debugfs_create_file("stats", 0400, state->debugfs, net, &dummy_net_fops);
+    }
+    error = dns_init_c(&state->dns, state->debugfs);
+    if(error) { goto fail; }
+    error = canned_init_c(&state->canned, state->debugfs);
+    if(error) { dns_destroy_c(&state->dns); goto fail; }
+    return 0;
+
+fail:
+    debugfs_remove(state->stats);
+    if(net != &init_net) { debugfs_remove_recursive(state->debugfs); }
+    return error;
+}
+
+static void __net_exit dummy_net_exit(struct net *net) {
+    struct dummy_net *state = net_generic(net, dummy_net_id);
+    struct net_device *dev;
+    struct net_device *next;
+    LIST_HEAD(list);
+
+    /* removes (in a single batch) the devices of the namespace that
+    is exiting, before the state of the namespace is released */
+    rtnl_lock();
+    for_each_netdev_safe(net, dev, next) {
+        if(dev->rtnl_link_ops != &dummy_link_ops) { continue; }
+        unregister_netdevice_queue(dev, &list);
+    }
+    unregister_netdevice_many(&list);
+    rtnl_unlock();
+
+    /* removes the files of the namespace before its state is
+    released, the directory of the initial namespace is the root
+    directory that is only removed with the module */
+    debugfs_remove(state->stats);
+    dns_destroy_c(&state->dns);
+    canned_destroy_c(&state->canned);
+    if(net != &init_net) { debugfs_remove_recursive(state->debugfs); }
+}
+
+static struct pernet_operations dummy_net_ops = {
+    .init = dummy_net_init,
+    .exit = dummy_net_exit,
+    .id = &dummy_net_id,
+    .size = sizeof(struct dummy_net),
+};
+
+static int dummy_dev_init(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    int error;
+
+    /* in case the per cpu statistics mode is in use the
+    statistics are allocated now, otherwise the allocation
+    is either delayed to the opening or never done */
+    if(stats_mode == DUMMY_STATS_PERCPU) {
+        error = dummy_stats_alloc(dev);
+        if(error) { return error; }
+    }
+
+    /* allocates the receive queues of the device, in case
+    of error the (possibly) allocated statistics are released */
+    error = dummy_rx_alloc(dev);
+    if(error) {
+        free_percpu(dev->dstats);
+        dev->dstats = NULL;
+        return error;
+    }
+
+    /* sets the default kinds of frames of the benchmark, all of
+    them (arp, icmp and udp) injected in round robin */
+    priv->bench_mask = (1 << BENCH_KINDS) - 1;
+
+    /* sets the default mode of the mirroring (once a mirror
+    device is set) as both the requests and the responses */
+    priv->mirror_mode = DUMMY_MIRROR_REQUEST | DUMMY_MIRROR_RESPONSE;
+    priv->stats_usecs = DUMMY_STATS_USECS;
+    mutex_init(&priv->bench_mutex);
+
+    /* the debugfs directory of the device is only created once
+    it's registered (notifier), as it depends on its namespace */
+    dummy_rss_init(dev);
+    return 0;
+}
+
+static int dummy_open(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    unsigned int index;
+    int error;
+
+    /* in case the lazy statistics mode is in use the per cpu
+    statistics are allocated on the first opening of the device,
+    so that devices that are never used take no per cpu memory */
+    if(stats_mode == DUMMY_STATS_LAZY) {
+        error = dummy_stats_alloc(dev);
+        if(error) { return error; }
+    }
+
+    /* enables the napi contexts of the receive queues that
+    are going to be used while the device is open, each of the
+    queues is assigned to an online cpu (round robin) that is
+    the target of the frames steered to the queue */
+    for(index = 0; index < dev->real_num_rx_queues; index++) {
+        priv->rx_queues[index].cpu = dummy_rx_cpu(index);
+        napi_enable(&priv->rx_queues[index].napi);
+    }
+
+    /* starts the transmit queues, any of them may have been
+    left stopped (congestion) when the device was closed */
+    netif_tx_start_all_queues(dev);
+    return 0;
+}
+
+static int dummy_stop(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct dummy_rx_queue *rx_queue;
+    unsigned int index;
+
+    /* stops the benchmark threads (if running) as these inject
+    frames into the transmit path of the device */
+    mutex_lock(&priv->bench_mutex);
+    dummy_bench_stop(dev);
+    mutex_unlock(&priv->bench_mutex);
+
+    /* disables the napi contexts (waiting for any running poll)
+    and releases the frames that remain in the queues */
+    for(index = 0; index < dev->real_num_rx_queues; index++) {
+        rx_queue = &priv->rx_queues[index];
+        hrtimer_cancel(&rx_queue->timer);
+        napi_disable(&rx_queue->napi);
+        while(test_bit(DUMMY_RX_KICK, &rx_queue->state)) { cpu_relax(); }
+        while(test_bit(DUMMY_RX_POLL, &rx_queue->state)) { cpu_relax(); }
+        hrtimer_cancel(&rx_queue->timer);
+        atomic_set(&rx_queue->coalesced, 0);
+        skb_queue_purge(&rx_queue->input);
+        __skb_queue_purge(&rx_queue->process);
+        bitmap_zero(rx_queue->stopped, dev->num_tx_queues);
+        bitmap_zero(rx_queue->completed, dev->num_tx_queues);
+        memset(rx_queue->completions, 0, dev->num_tx_queues * sizeof(struct dummy_tx_completion));
+    }
+
+    /* resets the byte queue limits of the transmit queues as the
+    frames purged from the receive queues are never completed */
+    for(index = 0; index < dev->num_tx_queues; index++) {
+        netdev_tx_reset_queue(netdev_get_tx_queue(dev, index));
+    }
+
+    return 0;
+}
+
+static void dummy_dev_uninit(struct net_device *dev) {
+    struct dummy_priv *priv = netdev_priv(dev);
+    struct mcast_filter *filter;
+
+    /* releases the multicast filter of the device, after
+    the grace period of any reader that may be using it */
+    filter = rcu_dereference_protected(priv->mc_filter, 1);
+    RCU_INIT_POINTER(priv->mc_filter, NULL);
+    if(filter != NULL) { kfree_rcu(filter, rcu); }
+
+    /* removes the debugfs directory of the device (in case it's
+    still present) and releases the receive queues (napi contexts) */
+    dummy_debugfs_remove(dev);
+    dummy_bench_free(dev);
+
+    /* stops the publication of the statistics page (in case it's
+    open) as the statistics of the device are going to be released */
+    mutex_lock(&dummy_export_mutex);
+    if(priv->stats_export != NULL) { dummy_export_stop(priv->stats_export); }
+    mutex_unlock(&dummy_export_mutex);
+
+    dummy_rx_free(dev);
+
+    /* releases the device statistics structure
+    in a per cpu basis (for all cpus), note that the
+    structure may not be allocated (compact mode) */
+    free_percpu(dev->dstats);
+    dev->dstats = NULL;
+}
+
+static void dummy_setup(struct net_device *dev) {
+    /* runs the ethernet setup operation on
+    the device (generic startup) */
+    ether_setup(dev);
+
+    /* initializes the device structure */
+    dev->netdev_ops = &dummy_netdev_ops;
+    dev->ethtool_ops = &dummy_ethtool_ops;
+    dev->destructor = free_netdev;
+
+    /* sets the vlan tag offload features so that the tags
+    are provided out of band (metadata) by the stack and not
+    inserted into the data of the frames */
+    dev->hw_features = NETIF_F_HW_VLAN_CTAG_TX | NETIF_F_HW_VLAN_CTAG_RX;
+
+    /* sets the scatter gather (and the required checksum) features
+    so that non linear frames are handed to the driver, these are
+    reflected referencing the pages (no copy) so any checksum that
+    is left partial by the stack remains valid on receive */
+    dev->hw_features |= NETIF_F_SG | NETIF_F_HW_CSUM | NETIF_F_RXCSUM | NETIF_F_HIGHDMA;
+    dev->hw_features |= NETIF_F_RXHASH;
+    dev->features |= dev->hw_features;
+    dev->vlan_features = NETIF_F_SG | NETIF_F_HW_CSUM | NETIF_F_HIGHDMA;
+
+    /* sets the maximum transmit unit, this should
+    be the normal value (may be changed up to the
+    jumbo limit of the device) */
+    dev->mtu = 1500;
+
+    /* sets the length of the transmit queue so that a qdisc is
+    attached to the device, holding the frames while the queues
+    are stopped (congestion or byte queue limits), with no qdisc
+    (noqueue) the frames sent to a stopped queue would be dropped */
+    dev->tx_queue_len = DUMMY_TX_QUEUE_LEN;
+    random_ether_addr(dev->dev_addr);
+}
+
+static int dummy_validate(struct nlattr *tb[], struct nlattr *data[]) {
+    if(tb[IFLA_ADDRESS]) {
+        if(nla_len(tb[IFLA_ADDRESS]) != ETH_ALEN) {
+            return -EINVAL;
+        }
+        if(!is_valid_ether_addr(nla_data(tb[IFLA_ADDRESS]))) {
+            return -EADDRNOTAVAIL;
+        }
+    }
 
     return 0;
+}
+
+static struct net_device *__init dummy_alloc_one(int index) {
+    struct net_device *dev_dummy;
+
+    dev_dummy = alloc_netdev_mqs(
+        sizeof(struct dummy_priv),
+        "dummy%d",
+        dummy_setup,
+        num_queues,
+        num_queues
+    );
+    if(!dev_dummy) { return NULL; }
+
+    /* sets the final name of the device directly, avoiding the
+    (linear) scan of the existing devices that is performed for
+    template names while holding the rtnl lock */
+    snprintf(dev_dummy->name, IFNAMSIZ, "dummy%d", index);
+    dev_dummy->rtnl_link_ops = &dummy_link_ops;
+
+    /* pre-allocates the per cpu statistics (if required) so
+    that the allocation is not done under the rtnl lock */
+    if(stats_mode == DUMMY_STATS_PERCPU && dummy_stats_alloc(dev_dummy)) {
+        free_netdev(dev_dummy);
+        return NULL;
+    }
+
+    return dev_dummy;
+}
+
+static int __init dummy_init_one(struct net_device *dev_dummy) {
+    int error;
+
+    /* tries to register the device with the pre-defined name,
+    in case the name is already taken (eg: other dummy driver)
+    falls back to the template name allocation */
+    error = register_netdevice(dev_dummy);
+    if(error == -EEXIST) {
+        strlcpy(dev_dummy->name, "dummy%d", IFNAMSIZ);
+        error = register_netdevice(dev_dummy);
+    }
 
-error:
-    free_netdev(dev_dummy);
     return error;
 }
 
 static int __init dummy_init_module(void) {
-    /* allocates space for both the index counter
-    and the error flag (started at no error) */
+    /* allocates space for the index counters, the batch
+    of devices and the error flag (started at no error) */
+    struct net_device **batch;
+    struct net_device *first = NULL;
     int index;
+    int offset;
+    int count;
     int error = 0;
 
-    rtnl_lock();
-    error = __rtnl_link_register(&dummy_link_ops);
+    /* normalizes the size of the batch and the number of
+    queues, note that at least one device must be registered
+    per lock acquisition and that one queue is required */
+    if(bulk_size < 1) { bulk_size = 1; }
+    if(pair_devices && bulk_size % 2) { bulk_size++; }
+    if(num_queues < 1) { num_queues = 1; }
+
+    batch = kcalloc(bulk_size, sizeof(struct net_device *), GFP_KERNEL);
+    if(!batch) { return -ENOMEM; }
+
+    /* seeds the (per cpu) identifiers of the IPv4 datagrams
+    that are built by the driver (eg: canned responses) */
+    ip_ident_init_c();
+
+    /* creates the root debugfs directory of the module, a
+    failure is not fatal (devices are created with no tuning) */
+    dummy_debugfs = debugfs_create_dir("net_dummy", NULL);
+    if(IS_ERR(dummy_debugfs)) { dummy_debugfs = NULL; }
+
+    /* allocates the (per cpu) capture rings, that are shared
+    by all of the devices (records contain the interface) */
+    capture_snap_len = clamp(capture_snap_len, ETH_HLEN, DUMMY_CAPTURE_MAX_SNAP_LEN);
+    error = capture_init_c(dummy_debugfs, max(capture_slots, 0), capture_snap_len);
+    if(error < 0) { goto free; }
+
+    /* allocates the (per cpu) heavy hitter sketches, shared
+    by all of the devices that have the tracking enabled */
+    error = sketch_init_c(dummy_debugfs, max(sketch_width, 0));
+    if(error < 0) { goto free; }
+
+    /* registers the per namespace state of the driver, creating
+    the state (directory, dns table, etc.) of existing namespaces */
+    error = register_pernet_device(&dummy_net_ops);
+    if(error < 0) { goto free; }
+
+    /* registers the notifier that creates the debugfs directories
+    of the devices and releases the mirror devices once they are
+    unregistered, before any device is created */
+    error = register_netdevice_notifier(&dummy_notifier);
+    if(error < 0) { unregister_pernet_device(&dummy_net_ops); goto free; }
+
+    error = rtnl_link_register(&dummy_link_ops);
+    if(error < 0) {
+        unregister_netdevice_notifier(&dummy_notifier);
+        unregister_pernet_device(&dummy_net_ops);
+        goto free;
+    }
 
     /* iterates over the range of devices (number of devices)
-    to be allocated in order to create them */
-    for(index = 0; index < num_devices && !error; index++) {
-        error = dummy_init_one();
+    to be created in batches, the allocation of each batch is
+    done without the lock and only the registration is done
+    while holding the rtnl lock */
+    for(index = 0; index < num_devices && !error; index += count) {
+        count = min(bulk_size, num_devices - index);
+
+        for(offset = 0; offset < count; offset++) {
+            batch[offset] = dummy_alloc_one(index + offset);
+            if(!batch[offset]) { error = -ENOMEM; break; }
+        }
+
+        rtnl_lock();
+        for(offset = 0; offset < count && !error; offset++) {
+            error = dummy_init_one(batch[offset]);
+            if(error < 0) { break; }
+
+            /* links every second device with the previous one in
+            case pairs are requested, the size of the batches is even
+            so that the devices of a pair are in the same batch */
+            if(pair_devices && offset % 2 == 1) { dummy_peer_link(first, batch[offset]); }
+            first = batch[offset];
+            batch[offset] = NULL;
+        }
+        rtnl_unlock();
+
+        /* releases the devices of the batch that have not been
+        registered (in case of error), their statistics are not
+        owned by the device so they must be released manually */
+        for(offset = 0; offset < count; offset++) {
+            if(!batch[offset]) { continue; }
+            free_percpu(batch[offset]->dstats);
+            free_netdev(batch[offset]);
+            batch[offset] = NULL;
+        }
+
         cond_resched();
     }
 
-    if(error < 0) { __rtnl_link_unregister(&dummy_link_ops); }
-
-    rtnl_unlock();
+    /* in case there was an error unregisters the link
+    operations, this removes the already registered devices */
+    if(error < 0) {
+        rtnl_link_unregister(&dummy_link_ops);
+        unregister_netdevice_notifier(&dummy_notifier);
+        unregister_pernet_device(&dummy_net_ops);
+    }
 
+free:
+    if(error < 0) {
+        debugfs_remove_recursive(dummy_debugfs);
+        capture_destroy_c();
+        sketch_destroy_c();
+    }
+    kfree(batch);
     return error;
 }
 
 static void __exit dummy_cleanup_module(void) {
     rtnl_link_unregister(&dummy_link_ops);
+    unregister_netdevice_notifier(&dummy_notifier);
+    unregister_pernet_device(&dummy_net_ops);
+    debugfs_remove_recursive(dummy_debugfs);
+    capture_destroy_c();
+    sketch_destroy_c();
 }
 
 /* sets the number devices to be set up by this module,
@@ -409,6 +2900,38 @@ by defult this number should only be one */
 module_param(num_devices, int, 0);
 MODULE_PARM_DESC(num_devices, "Number of pseudo devices, to be created");
 
+/* sets the number of devices registered per acquisition
+of the rtnl lock while creating the devices at load */
+module_param(bulk_size, int, 0);
+MODULE_PARM_DESC(bulk_size, "Number of devices registered per rtnl lock acquisition");
+
+/* sets if the devices are linked in pairs, forwarding
+the frames to each other instead of reflecting them */
+module_param(pair_devices, int, 0);
+MODULE_PARM_DESC(pair_devices, "Link the devices in pairs (0 - disabled, 1 - enabled)");
+
+/* sets the mode of the statistics, that controls the
+memory footprint of each of the devices */
+module_param(stats_mode, int, 0);
+MODULE_PARM_DESC(stats_mode, "Statistics mode (0 - per cpu, 1 - lazy per cpu, 2 - compact)");
+
+/* sets the number of queues of each device, each of
+the receive queues has its own napi (gro) context */
+module_param(num_queues, int, 0);
+MODULE_PARM_DESC(num_queues, "Number of (transmit and receive) queues per device");
+
+/* sets the size of the capture rings, these are allocated
+once per cpu and shared by all of the devices */
+module_param(capture_slots, int, 0);
+MODULE_PARM_DESC(capture_slots, "Number of records per cpu capture ring (0 - disabled)");
+module_param(capture_snap_len, int, 0);
+MODULE_PARM_DESC(capture_snap_len, "Maximum number of bytes captured per frame");
+
+/* sets the width of the heavy hitter sketches, these are
+allocated once per cpu and shared by all of the devices */
+module_param(sketch_width, int, 0);
+MODULE_PARM_DESC(sketch_width, "Number of counters per row of the per cpu sketches (0 - disabled)");
+
 /* sets the initialization, finalization functions and
 the module name and license */
 module_init(dummy_init_module);
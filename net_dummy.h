@@ -27,6 +27,241 @@
 
 #pragma once
 
+/**
+ * Statistics mode where each device allocates its counters
+ * for each of the possible cpus at initialization.
+ */
+#define DUMMY_STATS_PERCPU 0
+
+/**
+ * Statistics mode where the per cpu counters are only allocated
+ * on the first opening of the device (devices never set up
+ * don't pay the per cpu cost).
+ */
+#define DUMMY_STATS_LAZY 1
+
+/**
+ * Statistics mode where a single set of atomic counters is
+ * used per device, independently of the number of cpus.
+ */
+#define DUMMY_STATS_COMPACT 2
+
+/**
+ * The minimum value for the maximum transmit unit
+ * of the device (minimum for ipv4).
+ */
+#define DUMMY_MIN_MTU 68
+
+/**
+ * The maximum value for the maximum transmit unit
+ * of the device, allowing jumbo frames up to 64K.
+ */
+#define DUMMY_MAX_MTU 65535
+
+/**
+ * The maximum number of frames that may be pending
+ * in each of the receive queues of the device.
+ */
+#define DUMMY_RX_QUEUE_SIZE 1024
+
+/**
+ * The length of the transmit queue (qdisc) of the device,
+ * holding the frames while the transmit queues are stopped.
+ */
+#define DUMMY_TX_QUEUE_LEN 1000
+
+/**
+ * The maximum number of responses that may be
+ * propagated for each request (fan out factor).
+ */
+#define DUMMY_MAX_FANOUT 64
+
+/**
+ * The size (in bytes) of the key of the receive side
+ * scaling hash (same as the one used by most nics).
+ */
+#define DUMMY_RSS_KEY_SIZE 40
+
+/**
+ * The number of entries of the receive side scaling
+ * indirection table (hash to receive queue).
+ */
+#define DUMMY_RSS_INDIR_SIZE 128
+
+/**
+ * The identifiers of the hash functions that may be used
+ * for the receive side scaling hash of the frames.
+ */
+#define DUMMY_RSS_TOEPLITZ 0
+#define DUMMY_RSS_JHASH 1
+
+/**
+ * The bit of the state of a receive queue that is set
+ * while an ipi (kick) to the cpu of the queue is pending.
+ */
+#define DUMMY_RX_KICK 0
+
+/**
+ * The bit of the state of a receive queue that is set while
+ * the queue is owned by either the napi poll or a busy polling
+ * socket (these are mutually exclusive).
+ */
+#define DUMMY_RX_POLL 1
+
+/**
+ * The maximum number of frames received by each call of
+ * the busy poll (in the context of the polling socket).
+ */
+#define DUMMY_BUSY_POLL_BUDGET 4
+
+/**
+ * The number of pending frames in a receive queue from which
+ * the transmit queue of the frames is stopped (backpressure),
+ * leaving room for a complete fan out before the queue is full.
+ */
+#define DUMMY_RX_QUEUE_STOP (DUMMY_RX_QUEUE_SIZE - DUMMY_MAX_FANOUT)
+
+/**
+ * The number of pending frames in a receive queue under
+ * which the transmit queues stopped by it are woken.
+ */
+#define DUMMY_RX_QUEUE_WAKE (DUMMY_RX_QUEUE_SIZE / 2)
+
+/**
+ * The identifiers of the (per reason) events counted by
+ * the device, the drops of the receive path, the frames with
+ * no response and the stops of the transmit queues.
+ */
+#define DUMMY_EVENT_QUEUE_FULL 0
+#define DUMMY_EVENT_NO_MEMORY 1
+#define DUMMY_EVENT_UNANSWERED 2
+#define DUMMY_EVENT_QUEUE_STOP 3
+#define DUMMY_EVENT_MIRROR_DROP 4
+#define DUMMY_EVENT_PEER_DROP 5
+#define DUMMY_EVENT_COUNT 6
+
+/**
+ * The magic and the version (of the layout) of the memory
+ * mapped statistics page of a device.
+ */
+#define DUMMY_STATS_MAGIC 0x44535441
+#define DUMMY_STATS_VERSION 1
+
+/**
+ * The default and the minimum interval (in microseconds)
+ * between the publications of the statistics page, the
+ * interval is rounded up to jiffies (work queue).
+ */
+#define DUMMY_STATS_USECS 10000
+#define DUMMY_STATS_MIN_USECS 1000
+
+/**
+ * Structure that defines the counters of a device (or of one
+ * of the cpus of the device) in the memory mapped statistics
+ * page, shared with userspace.
+ */
+struct dummy_stats_counters {
+    __u64 rx_packets;
+    __u64 tx_packets;
+    __u64 rx_bytes;
+    __u64 tx_bytes;
+    __u64 events[DUMMY_EVENT_COUNT];
+};
+
+/**
+ * Structure that defines the header of the (read only) memory
+ * mapped statistics page of a device, followed by the counters
+ * of each of the cpus (indexed by the cpu).
+ *
+ * The sequence is odd while the page is being written (seqlock),
+ * readers must retry in case it's odd or changed while reading.
+ */
+struct dummy_stats_header {
+    __u32 magic;
+    __u32 version;
+    __u32 sequence;
+    __u32 cpus;
+    __u32 events;
+    __u32 usecs;
+    __u64 timestamp;
+    __u64 publications;
+    struct dummy_stats_counters total;
+    struct dummy_stats_counters cpu[0];
+};
+
+/**
+ * The bits of the mirroring mode of the device, selecting the
+ * frames mirrored, the ones taken by the device (requests) and/or
+ * the ones built by the responders (responses).
+ */
+#define DUMMY_MIRROR_REQUEST 0x01
+#define DUMMY_MIRROR_RESPONSE 0x02
+
+/**
+ * The maximum deadline (in microseconds) of the coalescing
+ * of the receive interrupts of the queues.
+ */
+#define DUMMY_COALESCE_MAX_USECS 100000
+
+/**
+ * The duration (in nanoseconds) of the window over which the
+ * rate of a queue is sampled for the adaptive coalescing.
+ */
+#define DUMMY_COALESCE_WINDOW_NS 10000000
+
+/**
+ * The address used by the benchmark frames in case the
+ * device has no address (198.18.0.1, benchmark range).
+ */
+#define DUMMY_BENCH_ADDRESS 0xc6120001
+
+/**
+ * The number of frames injected by a benchmark thread
+ * between the voluntary rescheduling points.
+ */
+#define DUMMY_BENCH_BATCH 64
+
+/**
+ * The wait (in nanoseconds) under which the benchmark
+ * threads spin instead of sleeping to pace the frames.
+ */
+#define DUMMY_BENCH_SPIN_NS 50000
+
+/**
+ * The maximum number of bytes of a frame that may
+ * be copied into a record of the capture rings.
+ */
+#define DUMMY_CAPTURE_MAX_SNAP_LEN 4096
+
+/**
+ * The identifiers of the responders of the device, these
+ * identify the responder that built the response for a frame
+ * (eg: in the capture records), none means no response.
+ */
+#define DUMMY_RESPONDER_NONE 0
+#define DUMMY_RESPONDER_ARP 1
+#define DUMMY_RESPONDER_IP 2
+#define DUMMY_RESPONDER_IPV6 3
+#define DUMMY_RESPONDER_MULTICAST 4
+#define DUMMY_RESPONDER_CUSTOM 5
+#define DUMMY_RESPONDER_DNS 6
+#define DUMMY_RESPONDER_CANNED 7
+
+/**
+ * The number of responder identifiers (all of them are
+ * below this value), used to size the per responder counters.
+ */
+#define DUMMY_RESPONDER_COUNT 8
+
+/**
+ * The (pseudo) responder returned by the echo operation in case
+ * the frame was consumed by a registered responder, meaning that
+ * the frame is no longer owned by the driver.
+ */
+#define DUMMY_RESPONDER_CONSUMED 0xff
+
+struct dummy_rx_queue;
+
 /**
  * Function called to set the address, in this case only the mac
  * address to the device once the initialization is complete.
@@ -44,15 +279,321 @@ static int dummy_set_address(struct net_device *dev, void *parameters);
  * Function called to set the multicast address in the provided
  * device.
  *
- * Under the current module this call as no effect.
+ * Rebuilds the (hash) filter of the joined groups from the
+ * multicast list of the device, replacing the previous one.
  *
  * @param dev The device to be used for the setting of the address.
  */
 static void dummy_set_multicast(struct net_device *dev);
 static struct rtnl_link_stats64 *dummy_get_stats64(struct net_device *dev, struct rtnl_link_stats64 *stats);
+
+/**
+ * Updates the transmit statistics of the device, called
+ * once the frame is taken by the driver (the receive side
+ * is only accounted once a response is queued).
+ *
+ * @param dev The device to update the statistics for.
+ * @param len The length of the transmitted frame.
+ */
+static void dummy_stats_tx(struct net_device *dev, unsigned int len);
+
+/**
+ * Allocates the per cpu statistics structure for the
+ * provided device, in case it's not already allocated.
+ *
+ * @param dev The device to allocate the statistics for.
+ * @return The result of the allocation, zero in case of
+ * success and a negative error code otherwise.
+ */
+static int dummy_stats_alloc(struct net_device *dev);
+
+/**
+ * Updates the receive statistics of the device, called for
+ * each of the frames queued in a receive queue.
+ *
+ * @param dev The device to update the statistics for.
+ * @param len The length of the received frame.
+ */
+static void dummy_stats_rx(struct net_device *dev, unsigned int len);
+
+/**
+ * Counts an event (eg: a drop) of the provided reason.
+ *
+ * @param dev The device to update the statistics for.
+ * @param event The identifier of the event to be counted.
+ */
+static void dummy_stats_event(struct net_device *dev, unsigned int event);
+
+/**
+ * Retrieves the (summed) counters of the events of the device.
+ *
+ * @param dev The device to retrieve the counters from.
+ * @param events The buffer for the DUMMY_EVENT_COUNT counters.
+ */
+static void dummy_stats_events(struct net_device *dev, u64 *events);
+
+/**
+ * Allocates a new frame (to be received by the device) with
+ * the provided size, the data is left for the caller to fill.
+ *
+ * @param dev The device that is going to receive the frame.
+ * @param size The size of the frame (including mac header).
+ * @return The allocated frame or NULL in case of error.
+ */
+static struct sk_buff *dummy_rx_build(struct net_device *dev, unsigned int size);
+
+/**
+ * Injects the provided (newly built) frame in the receive path
+ * of the device, accounting it as received.
+ *
+ * @param skb The frame to be injected, starting at the mac header.
+ * @param dev The device that is going to receive the frame.
+ * @return The result of the queuing of the frame.
+ */
+static int dummy_rx_inject(struct sk_buff *skb, struct net_device *dev);
+
+/**
+ * Checks if the provided (IPv6) address is part of any of the
+ * prefixes configured in the device, these are the addresses
+ * for which neighbor solicitations are answered.
+ *
+ * @param dev The device to be used in the verification.
+ * @param address The address to be verified.
+ * @return If the address is owned (emulated) by the device.
+ */
+static bool dummy_xmit_owns(struct net_device *dev, const struct in6_addr *address);
+
+/**
+ * Rewrites (in place) the provided IPv6 frame into its response,
+ * either a neighbor advertisement, a dns response or the reflected
+ * packet, the data must start at the network header.
+ *
+ * @param skb The frame to be rewritten.
+ * @param dev The device that is responding to the frame.
+ * @return The responder that built the response or none in case
+ * the frame is not answered.
+ */
+static u8 dummy_xmit_ipv6(struct sk_buff *skb, struct net_device *dev);
+
+/**
+ * Changes the maximum transmit unit of the device, the
+ * value must be in the range of the device (up to 64K).
+ *
+ * @param dev The device to change the maximum transmit unit.
+ * @param new_mtu The new value for the maximum transmit unit.
+ * @return The result of the change, zero in case of success.
+ */
+static int dummy_change_mtu(struct net_device *dev, int new_mtu);
 static netdev_tx_t dummy_xmit(struct sk_buff *skb, struct net_device *dev);
 static int dummy_dev_init(struct net_device *dev);
 static void dummy_dev_uninit(struct net_device *dev);
+static int dummy_open(struct net_device *dev);
+static int dummy_stop(struct net_device *dev);
+
+/**
+ * Queues the provided (reflected) frame in the receive
+ * queue paired with its transmit queue and schedules
+ * the napi context of the receive queue.
+ *
+ * @param skb The frame to be queued for receive.
+ * @param dev The device to receive the frame.
+ * @param flow If the transmit queue of the frame (of the
+ * same device) should be stopped on congestion.
+ * @return The result of the queuing, either NET_RX_SUCCESS
+ * or NET_RX_DROP (in which case the frame is released).
+ */
+static int dummy_rx_enqueue(struct sk_buff *skb, struct net_device *dev, bool flow);
+
+/**
+ * Stops the transmit queue with the provided index because
+ * the receive queue is congested, the queue is woken once
+ * the receive queue is drained (by its poll).
+ *
+ * @param dev The device of the queues.
+ * @param rx_queue The congested receive queue.
+ * @param index The index of the transmit queue to be stopped.
+ */
+static void dummy_tx_stop(struct net_device *dev, struct dummy_rx_queue *rx_queue, u16 index);
+
+/**
+ * Wakes all of the transmit queues that have been stopped
+ * by the provided receive queue.
+ *
+ * @param dev The device of the queues.
+ * @param rx_queue The (drained) receive queue.
+ */
+static void dummy_tx_wake(struct net_device *dev, struct dummy_rx_queue *rx_queue);
+
+/**
+ * Accumulates the completion (byte queue limits) of the provided
+ * frame, that is being received, in the receive queue.
+ *
+ * @param rx_queue The receive queue of the frame.
+ * @param skb The frame being received.
+ */
+static inline void dummy_tx_account(struct dummy_rx_queue *rx_queue, struct sk_buff *skb);
+
+/**
+ * Reports the completions accumulated by the receive queue to
+ * the transmit queues (byte queue limits), that may be woken.
+ *
+ * @param dev The device of the queues.
+ * @param rx_queue The receive queue with the completions.
+ */
+static void dummy_tx_complete(struct net_device *dev, struct dummy_rx_queue *rx_queue);
+
+/**
+ * Polls the receive queue associated with the napi context
+ * handing the frames to gro, this is the bottom half of
+ * the emulated receive interrupt of the device.
+ *
+ * @param napi The napi context of the receive queue.
+ * @param budget The maximum number of frames to be received.
+ * @return The number of frames received.
+ */
+static int dummy_poll(struct napi_struct *napi, int budget);
+
+/**
+ * Raises the (emulated) receive interrupt of the queue, either
+ * scheduling its napi context on the current cpu or sending an
+ * ipi to the cpu of the queue.
+ *
+ * @param rx_queue The receive queue to raise the interrupt for.
+ * @param remote If the interrupt should be raised on the cpu of
+ * the queue (instead of the current one).
+ */
+static void dummy_rx_signal(struct dummy_rx_queue *rx_queue, bool remote);
+
+/**
+ * Coalesces the receive interrupt of the queue for a frame that
+ * has just been queued, holding it until the frame limit or the
+ * deadline (timer) of the queue is reached.
+ *
+ * @param rx_queue The receive queue of the frame.
+ * @return If the interrupt is held (nothing to be signaled).
+ */
+static bool dummy_rx_coalesce(struct dummy_rx_queue *rx_queue);
+
+/**
+ * Polls the receive queue associated with the napi context in
+ * the context of a busy polling socket (SO_BUSY_POLL), receiving
+ * a small number of frames without gro.
+ *
+ * @param napi The napi context of the receive queue.
+ * @return The number of frames received or LL_FLUSH_BUSY in case
+ * the queue is being polled by the napi poll.
+ */
+static int dummy_busy_poll(struct napi_struct *napi);
+
+/**
+ * Computes the (receive side scaling) flow hash of the provided
+ * frame over its addresses and ports, setting it in the frame
+ * together with the type of the hash (l3 or l4).
+ *
+ * @param skb The frame to compute the hash for, the data must
+ * start at the network header.
+ * @param dev The device that contains the key of the hash.
+ */
+static void dummy_rss_hash(struct sk_buff *skb, struct net_device *dev);
+static int dummy_get_rxnfc(struct net_device *dev, struct ethtool_rxnfc *info, u32 *rule_locs);
+static u32 dummy_get_rxfh_key_size(struct net_device *dev);
+static u32 dummy_get_rxfh_indir_size(struct net_device *dev);
+static int dummy_get_rxfh(struct net_device *dev, u32 *indir, u8 *key);
+static int dummy_set_rxfh(struct net_device *dev, const u32 *indir, const u8 *key);
+
+/**
+ * Mirrors the provided frame (that must start at the mac header)
+ * to the mirror device of the provided one, in case the mode of the
+ * frame is enabled, the data of the frame is shared (clone) and any
+ * later rewrite of the headers is done on a private copy of them.
+ *
+ * @param skb The frame to be mirrored (not consumed).
+ * @param dev The device that is mirroring the frame.
+ * @param mode The mode (request or response) of the frame.
+ */
+static void dummy_mirror(struct sk_buff *skb, struct net_device *dev, u32 mode);
+
+/**
+ * Sets the device to which the frames of the provided device are
+ * mirrored, replacing the previous one (if any), a reference to the
+ * mirror device is held, must be called with the rtnl lock held.
+ *
+ * @param dev The device whose frames are going to be mirrored.
+ * @param mirror The mirror device or NULL to stop the mirroring.
+ * @return The result of the setting, zero in case of success.
+ */
+static int dummy_mirror_set(struct net_device *dev, struct net_device *mirror);
+
+/**
+ * Delivers the provided frame (that must start at the mac header)
+ * on the peer of the provided device, as if it was received by the
+ * peer from the wire, the frame itself is handed over (no copy).
+ *
+ * @param skb The frame to be delivered (consumed).
+ * @param dev The device that transmitted the frame.
+ * @param peer The peer device that receives the frame.
+ * @return The result of the delivery, either NET_RX_SUCCESS
+ * or NET_RX_DROP (in which case the frame is released).
+ */
+static int dummy_xmit_f(struct sk_buff *skb, struct net_device *dev, struct net_device *peer);
+
+/**
+ * Transmits the provided frame (the body of the transmit operation
+ * of the device), either answering it or forwarding it to the peer,
+ * the frame is always consumed.
+ *
+ * @param skb The frame to be transmitted (consumed).
+ * @param dev The device that transmits the frame.
+ * @return The identifier of the responder that built the response,
+ * none in case the frame was not answered (or was forwarded).
+ */
+static u8 dummy_xmit_r(struct sk_buff *skb, struct net_device *dev);
+
+/**
+ * Links the provided (dummy) devices as peers, the frames that are
+ * transmitted by one of them are received by the other, any previous
+ * link of both devices is removed, must be called with the rtnl lock.
+ *
+ * @param dev The first device of the pair.
+ * @param peer The second device of the pair.
+ * @return The result of the link, zero in case of success.
+ */
+static int dummy_peer_link(struct net_device *dev, struct net_device *peer);
+
+/**
+ * Removes the link of the provided device with its peer (if any)
+ * in both directions, releasing the references to the devices, must
+ * be called with the rtnl lock held.
+ *
+ * @param dev The device to be unlinked.
+ */
+static void dummy_peer_unlink(struct net_device *dev);
+
+/**
+ * Starts the benchmark of the device, creating one thread per
+ * online cpu that injects (prebuilt) frames directly into the
+ * transmit path, must be called with the rtnl lock and the
+ * lock of the benchmark of the device held.
+ *
+ * @param dev The device to be benchmarked (must be running).
+ * @return The result of the start, zero in case of success.
+ */
+static int dummy_bench_start(struct net_device *dev);
+
+/**
+ * Stops the benchmark of the device (if running), waiting
+ * for its threads, must be called with the rtnl lock and the
+ * lock of the benchmark of the device held.
+ *
+ * @param dev The device being benchmarked.
+ */
+static void dummy_bench_stop(struct net_device *dev);
+static int dummy_get_coalesce(struct net_device *dev, struct ethtool_coalesce *coalesce);
+static int dummy_set_coalesce(struct net_device *dev, struct ethtool_coalesce *coalesce);
+static int dummy_get_sset_count(struct net_device *dev, int sset);
+static void dummy_get_strings(struct net_device *dev, u32 stringset, u8 *data);
+static void dummy_get_ethtool_stats(struct net_device *dev, struct ethtool_stats *stats, u64 *data);
+static unsigned int dummy_get_num_queues(void);
 
 /**
  * Runs the setup operation in the current device, after
@@ -63,6 +604,16 @@ static void dummy_dev_uninit(struct net_device *dev);
  */
 static void dummy_setup(struct net_device *dev);
 static int dummy_validate(struct nlattr *tb[], struct nlattr *data[]);
-static int __init dummy_init_one(void);
+
+/**
+ * Allocates (without registering) a new device with the
+ * name for the provided index, this operation does not
+ * require the rtnl lock to be held.
+ *
+ * @param index The index of the device to be used in the name.
+ * @return The allocated device or NULL in case of error.
+ */
+static struct net_device *__init dummy_alloc_one(int index);
+static int __init dummy_init_one(struct net_device *dev_dummy);
 static int __init dummy_init_module(void);
 static void __exit dummy_cleanup_module(void);
@@ -0,0 +1,205 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#include "common.h"
+
+#include "net_mcast.h"
+
+static u64 mcast_key_c(const unsigned char *mac) {
+    /* converts the mac address into a key (integer) marked
+    as used so that zero is reserved for the empty slots */
+    return MCAST_FILTER_USED |
+        ((u64) mac[0] << 40) | ((u64) mac[1] << 32) | ((u64) mac[2] << 24) |
+        ((u64) mac[3] << 16) | ((u64) mac[4] << 8) | (u64) mac[5];
+}
+
+struct mcast_filter *mcast_filter_build_c(struct net_device *dev, gfp_t flags) {
+    struct mcast_filter *filter;
+    struct netdev_hw_addr *address;
+    unsigned int bits;
+    unsigned int index;
+    u64 key;
+
+    /* calculates the size of the table so that its load is
+    at most one half, keeping the probe sequences short */
+    bits = ilog2(roundup_pow_of_two(max(netdev_mc_count(dev), 1) * 2));
+    filter = kzalloc(sizeof(struct mcast_filter) + (sizeof(u64) << bits), flags);
+    if(filter == NULL) { return NULL; }
+    filter->bits = bits;
+
+    /* inserts each of the addresses of the multicast list into
+    the table (linear probing), duplicates are ignored */
+    netdev_for_each_mc_addr(address, dev) {
+        key = mcast_key_c(address->addr);
+        index = hash_64(key, bits);
+        while(filter->slots[index] && filter->slots[index] != key) {
+            index = (index + 1) & ((1 << bits) - 1);
+        }
+        if(filter->slots[index] == key) { continue; }
+        filter->slots[index] = key;
+        filter->count++;
+    }
+
+    return filter;
+}
+
+bool mcast_filter_match_c(const struct mcast_filter *filter, const unsigned char *mac) {
+    unsigned int index;
+    u64 key;
+
+    if(filter == NULL || filter->count == 0) { return false; }
+
+    key = mcast_key_c(mac);
+    index = hash_64(key, filter->bits);
+    while(filter->slots[index]) {
+        if(filter->slots[index] == key) { return true; }
+        index = (index + 1) & ((1 << filter->bits) - 1);
+    }
+
+    return false;
+}
+
+int igmp_query_c(unsigned char *data, unsigned int len, __be32 *group, __be32 *source) {
+    struct iphdr *header = (struct iphdr *) data;
+    struct igmphdr *igmp;
+    unsigned int header_size;
+
+    if(len < sizeof(struct iphdr)) { return 0; }
+    header_size = header->ihl * 4;
+    if(header->version != 4 || header->protocol != IPPROTO_IGMP) { return 0; }
+    if(len < header_size + sizeof(struct igmphdr)) { return 0; }
+
+    igmp = (struct igmphdr *) &(data[header_size]);
+    if(igmp->type != IGMP_HOST_MEMBERSHIP_QUERY) { return 0; }
+
+    *group = igmp->group;
+    *source = header->saddr;
+    return 1;
+}
+
+int mld_query_c(unsigned char *data, unsigned int len, struct in6_addr *group, struct in6_addr *source) {
+    struct ipv6hdr *header = (struct ipv6hdr *) data;
+    struct mld_msg *message;
+    unsigned int offset = sizeof(struct ipv6hdr);
+    u8 next = header->nexthdr;
+
+    if(len < sizeof(struct ipv6hdr) || header->version != 6) { return 0; }
+
+    /* skips the hop by hop options header (router alert) that
+    is expected to precede the messages of the protocol */
+    if(next == NEXTHDR_HOP) {
+        if(len < offset + 8) { return 0; }
+        next = data[offset];
+        offset += (data[offset + 1] + 1) * 8;
+    }
+
+    if(next != IPPROTO_ICMPV6) { return 0; }
+    if(len < offset + sizeof(struct mld_msg)) { return 0; }
+
+    message = (struct mld_msg *) &(data[offset]);
+    if(message->mld_type != ICMPV6_MGM_QUERY) { return 0; }
+
+    *group = message->mld_mca;
+    *source = header->saddr;
+    return 1;
+}
+
+unsigned int igmp_report_c(unsigned char *buffer, const unsigned char *mac, __be32 source, __be32 group) {
+    struct ethhdr *ethernet = (struct ethhdr *) buffer;
+    struct iphdr *header = (struct iphdr *) &(buffer[ETH_HLEN]);
+    unsigned char *options = (unsigned char *) &header[1];
+    struct igmphdr *igmp = (struct igmphdr *) &(options[4]);
+
+    memset(buffer, 0, IGMP_REPORT_SIZE);
+
+    /* builds the ethernet header targeting the mac address
+    of the group being reported */
+    ip_eth_mc_map(group, ethernet->h_dest);
+    memcpy(ethernet->h_source, mac, MAC_ADDRESS_SIZE);
+    ethernet->h_proto = htons(ETH_P_IP);
+
+    /* builds the ip header, including the router alert
+    option required for the messages of the protocol */
+    header->version = 4;
+    header->ihl = 6;
+    header->tos = 0xc0;
+    header->tot_len = htons(IGMP_REPORT_SIZE - ETH_HLEN);
+    header->id = ip_ident_c();
+    header->ttl = 1;
+    header->protocol = IPPROTO_IGMP;
+    header->saddr = source;
+    header->daddr = group;
+    options[0] = IPOPT_RA;
+    options[1] = 4;
+    header->check = ip_fast_csum((unsigned char *) header, header->ihl);
+
+    igmp->type = IGMPV2_HOST_MEMBERSHIP_REPORT;
+    igmp->group = group;
+    igmp->csum = ip_compute_csum(igmp, sizeof(struct igmphdr));
+
+    return IGMP_REPORT_SIZE;
+}
+
+unsigned int mld_report_c(unsigned char *buffer, const unsigned char *mac, const struct in6_addr *source, const struct in6_addr *group) {
+    struct ethhdr *ethernet = (struct ethhdr *) buffer;
+    struct ipv6hdr *header = (struct ipv6hdr *) &(buffer[ETH_HLEN]);
+    unsigned char *options = (unsigned char *) &header[1];
+    struct mld_msg *message = (struct mld_msg *) &(options[8]);
+
+    memset(buffer, 0, MLD_REPORT_SIZE);
+
+    ipv6_eth_mc_map(group, ethernet->h_dest);
+    memcpy(ethernet->h_source, mac, MAC_ADDRESS_SIZE);
+    ethernet->h_proto = htons(ETH_P_IPV6);
+
+    header->version = 6;
+    header->payload_len = htons(8 + sizeof(struct mld_msg));
+    header->nexthdr = NEXTHDR_HOP;
+    header->hop_limit = 1;
+    header->saddr = *source;
+    header->daddr = *group;
+
+    /* builds the hop by hop options header with the router
+    alert option (mld) followed by the padding option */
+    options[0] = IPPROTO_ICMPV6;
+    options[1] = 0;
+    options[2] = IPV6_TLV_ROUTERALERT;
+    options[3] = 2;
+    options[6] = IPV6_TLV_PADN;
+
+    message->mld_type = ICMPV6_MGM_REPORT;
+    message->mld_mca = *group;
+    message->mld_cksum = csum_ipv6_magic(
+        source,
+        group,
+        sizeof(struct mld_msg),
+        IPPROTO_ICMPV6,
+        csum_partial(message, sizeof(struct mld_msg), 0)
+    );
+
+    return MLD_REPORT_SIZE;
+}
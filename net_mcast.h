@@ -0,0 +1,115 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#pragma once
+
+#define MCAST_FILTER_USED (1ULL << 48)
+#define IGMP_REPORT_SIZE 46
+#define MLD_REPORT_SIZE 86
+
+/**
+ * Structure that defines the (exact) filter of the multicast
+ * groups joined in a device, an open addressing hash table of
+ * the mac addresses of the groups, replaced as a whole (rcu)
+ * whenever the groups of the device change.
+ */
+struct mcast_filter {
+    struct rcu_head rcu;
+    unsigned int bits;
+    unsigned int count;
+    u64 slots[0];
+};
+
+/**
+ * Builds a new filter from the multicast list of the provided
+ * device, must be called with the address lock of the device
+ * held (as in the set rx mode operation).
+ *
+ * @param dev The device to build the filter for.
+ * @param flags The flags to be used in the allocation.
+ * @return The new filter or NULL in case of error.
+ */
+struct mcast_filter *mcast_filter_build_c(struct net_device *dev, gfp_t flags);
+
+/**
+ * Verifies if the provided (multicast) mac address is part
+ * of the filter, the operation runs in constant time.
+ *
+ * @param filter The filter to be used, may be NULL (empty).
+ * @param mac The mac address to be verified.
+ * @return If the address is part of the filter (joined group).
+ */
+bool mcast_filter_match_c(const struct mcast_filter *filter, const unsigned char *mac);
+
+/**
+ * Verifies if the provided IPv4 packet is an IGMP membership
+ * query, retrieving the queried group and the source.
+ *
+ * @param data The pointer to the start of the IPv4 header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @param group Set with the queried group (zero for general).
+ * @param source Set with the source address of the query.
+ * @return If the packet is an IGMP membership query.
+ */
+int igmp_query_c(unsigned char *data, unsigned int len, __be32 *group, __be32 *source);
+
+/**
+ * Verifies if the provided IPv6 packet is an MLD listener
+ * query (after the hop by hop options header), retrieving
+ * the queried group and the source.
+ *
+ * @param data The pointer to the start of the IPv6 header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @param group Set with the queried group (unspecified for general).
+ * @param source Set with the source address of the query.
+ * @return If the packet is an MLD listener query.
+ */
+int mld_query_c(unsigned char *data, unsigned int len, struct in6_addr *group, struct in6_addr *source);
+
+/**
+ * Builds an (IGMPv2) membership report frame for the provided
+ * group into the buffer (of at least IGMP_REPORT_SIZE bytes).
+ *
+ * @param buffer The buffer to build the frame into.
+ * @param mac The source mac address of the frame.
+ * @param source The source address of the report.
+ * @param group The group to be reported.
+ * @return The size of the built frame.
+ */
+unsigned int igmp_report_c(unsigned char *buffer, const unsigned char *mac, __be32 source, __be32 group);
+
+/**
+ * Builds an (MLDv1) listener report frame for the provided
+ * group into the buffer (of at least MLD_REPORT_SIZE bytes).
+ *
+ * @param buffer The buffer to build the frame into.
+ * @param mac The source mac address of the frame.
+ * @param source The source address of the report.
+ * @param group The group to be reported.
+ * @return The size of the built frame.
+ */
+unsigned int mld_report_c(unsigned char *buffer, const unsigned char *mac, const struct in6_addr *source, const struct in6_addr *group);
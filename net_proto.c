@@ -0,0 +1,336 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#include "common.h"
+
+#include "net_proto.h"
+
+static void ports_swap_c(unsigned char *transport) {
+    /* switches the source and the destination ports, that
+    share the same position for both tcp and udp, note that
+    the operation is neutral for the checksum */
+    __be16 *ports = (__be16 *) transport;
+    __be16 port = ports[0];
+    ports[0] = ports[1];
+    ports[1] = port;
+}
+
+void ethernet_reflect_c(unsigned char *mac_header, const unsigned char *mac) {
+    /* sets the receiver of the packet as the sender of original
+    packet and sets the sender of the packet as the address of
+    the currently used device */
+    memcpy(&(mac_header[0]), &(mac_header[6]), MAC_ADDRESS_SIZE);
+    memcpy(&(mac_header[6]), mac, MAC_ADDRESS_SIZE);
+}
+
+int arp_reflect_c(unsigned char *data, unsigned int len, const unsigned char *mac) {
+    /* allocates space for the sender and receiver parts
+    of arp resolution request */
+    unsigned char sender_sum[SUM_ADDRESS_SIZE];
+    unsigned char receiver_sum[SUM_ADDRESS_SIZE];
+
+    /* ensures that the complete arp packet is available
+    in the buffer before any change is done to it */
+    if(len < ARP_PACKET_SIZE) { return 0; }
+
+    /* sets the reply opcode in the arp data, should
+    be able to validate the packet*/
+    data[7] = 0x02;
+
+    /* copies the sender and the receiver addresses from
+    the arp packet to switch them */
+    memcpy(sender_sum, &(data[8]), SUM_ADDRESS_SIZE);
+    memcpy(receiver_sum, &(data[18]), SUM_ADDRESS_SIZE);
+
+    /* switches the receiver and sender packets so that
+    a valid response is sent */
+    memcpy(&(data[8]), receiver_sum, SUM_ADDRESS_SIZE);
+    memcpy(&(data[18]), sender_sum, SUM_ADDRESS_SIZE);
+
+    /* copies the current device address to the sender
+    position for the address so that all the ip addresses
+    in the current sub network are assigned to this device */
+    memcpy(&(data[8]), mac, MAC_ADDRESS_SIZE);
+
+    return 1;
+}
+
+unsigned int flow_tuple_c(unsigned char *data, unsigned int len, __be16 protocol, unsigned char *tuple, bool *ports) {
+    struct iphdr *header = (struct iphdr *) data;
+    struct ipv6hdr *header6 = (struct ipv6hdr *) data;
+    unsigned int header_size;
+
+    *ports = false;
+
+    switch(protocol) {
+        case htons(ETH_P_IP):
+            if(len < sizeof(struct iphdr)) { return 0; }
+            header_size = header->ihl * 4;
+            memcpy(&(tuple[0]), &header->saddr, IP_ADDRESS_SIZE);
+            memcpy(&(tuple[4]), &header->daddr, IP_ADDRESS_SIZE);
+
+            /* only the first fragment contains the ports and, so
+            that all the fragments share the hash, fragments are
+            always hashed with the addresses only */
+            if(header->frag_off & htons(IP_MF | IP_OFFSET)) { return 8; }
+            if(header->protocol != IPPROTO_TCP && header->protocol != IPPROTO_UDP) { return 8; }
+            if(len < header_size + 4) { return 8; }
+
+            memcpy(&(tuple[8]), &(data[header_size]), 4);
+            *ports = true;
+            return 12;
+
+        case htons(ETH_P_IPV6):
+            if(len < sizeof(struct ipv6hdr)) { return 0; }
+            memcpy(&(tuple[0]), &header6->saddr, sizeof(struct in6_addr));
+            memcpy(&(tuple[16]), &header6->daddr, sizeof(struct in6_addr));
+
+            if(header6->nexthdr != IPPROTO_TCP && header6->nexthdr != IPPROTO_UDP) { return 32; }
+            if(len < sizeof(struct ipv6hdr) + 4) { return 32; }
+
+            memcpy(&(tuple[32]), &(data[sizeof(struct ipv6hdr)]), 4);
+            *ports = true;
+            return 36;
+
+        default:
+            return 0;
+    }
+}
+
+static int ipv4_options_c(unsigned char *options, unsigned int len) {
+    unsigned int offset = 0;
+    unsigned int option_len;
+
+    /* walks the options of the header verifying that these are
+    well formed, these are kept (unchanged) in the response with
+    the exception of the source routes, as a response would have
+    to follow the reversed route, which are not reflected */
+    while(offset < len) {
+        switch(options[offset]) {
+            case IPOPT_END:
+                return 1;
+            case IPOPT_NOOP:
+                offset++;
+                continue;
+            case IPOPT_LSRR:
+            case IPOPT_SSRR:
+                return 0;
+        }
+        if(offset + 1 >= len) { return 0; }
+        option_len = options[offset + 1];
+        if(option_len < 2 || offset + option_len > len) { return 0; }
+        offset += option_len;
+    }
+
+    return 1;
+}
+
+int ipv4_reflect_c(unsigned char *data, unsigned int len) {
+    struct iphdr *header = (struct iphdr *) data;
+    struct icmphdr *icmp;
+    unsigned int header_size;
+    __be32 address;
+
+    /* verifies that the buffer contains a valid ip header, with
+    the complete header (including options) available */
+    if(len < sizeof(struct iphdr)) { return 0; }
+    header_size = header->ihl * 4;
+    if(header->version != 4) { return 0; }
+    if(header_size < sizeof(struct iphdr) || header_size > len) { return 0; }
+    if(!ipv4_options_c(&(data[sizeof(struct iphdr)]), header_size - sizeof(struct iphdr))) { return 0; }
+
+    /* multicast and broadcast packets have no unicast source
+    to be used in the response, so they're not reflected */
+    if(ipv4_is_multicast(header->daddr) || ipv4_is_lbcast(header->daddr)) { return 0; }
+
+    /* the fragments are reflected individually (no reassembly),
+    keeping the identifier and the fragment fields so that the
+    responses are reassembled by the receiver, only the first
+    fragment has the transport header, the other ones only have
+    the addresses switched (the transport checksum covers the
+    complete datagram and the first fragment keeps it valid) */
+    if(header->frag_off & htons(IP_OFFSET)) {
+        if(header->protocol != IPPROTO_ICMP &&
+            header->protocol != IPPROTO_TCP &&
+            header->protocol != IPPROTO_UDP) { return 0; }
+    } else {
+        /* runs the transport specific rewrite, verifying first
+        that the transport header is available in the buffer */
+        switch(header->protocol) {
+            case IPPROTO_ICMP:
+                if(len < header_size + sizeof(struct icmphdr)) { return 0; }
+                icmp = (struct icmphdr *) &(data[header_size]);
+                if(icmp->type != ICMP_ECHO) { return 0; }
+
+                /* turns the request into a reply updating the checksum
+                incrementally (only the type word has changed) */
+                icmp->type = ICMP_ECHOREPLY;
+                csum_replace2(&icmp->checksum, htons(ICMP_ECHO << 8), htons(ICMP_ECHOREPLY << 8));
+                break;
+
+            case IPPROTO_TCP:
+            case IPPROTO_UDP:
+                if(len < header_size + 4) { return 0; }
+                ports_swap_c(&(data[header_size]));
+                break;
+
+            default:
+                return 0;
+        }
+    }
+
+    /* switches the source and destination addresses, the header
+    checksum remains valid as the sum of the words is the same */
+    address = header->saddr;
+    header->saddr = header->daddr;
+    header->daddr = address;
+
+    return 1;
+}
+
+int ipv6_reflect_c(unsigned char *data, unsigned int len) {
+    struct ipv6hdr *header = (struct ipv6hdr *) data;
+    struct icmp6hdr *icmp;
+    struct in6_addr address;
+    unsigned int header_size = sizeof(struct ipv6hdr);
+
+    /* verifies that the buffer contains a valid ipv6 header
+    and that the destination is an unicast address */
+    if(len < header_size) { return 0; }
+    if(header->version != 6) { return 0; }
+    if(ipv6_addr_is_multicast(&header->daddr)) { return 0; }
+
+    /* runs the transport specific rewrite, note that packets
+    with extension headers are not reflected */
+    switch(header->nexthdr) {
+        case IPPROTO_ICMPV6:
+            if(len < header_size + ICMPV6_HEADER_SIZE) { return 0; }
+            icmp = (struct icmp6hdr *) &(data[header_size]);
+            if(icmp->icmp6_type != ICMPV6_ECHO_REQUEST) { return 0; }
+
+            /* turns the request into a reply, the pseudo header
+            sum is not changed by the switch of the addresses so
+            only the type word must be considered in the update */
+            icmp->icmp6_type = ICMPV6_ECHO_REPLY;
+            csum_replace2(
+                &icmp->icmp6_cksum,
+                htons(ICMPV6_ECHO_REQUEST << 8),
+                htons(ICMPV6_ECHO_REPLY << 8)
+            );
+            break;
+
+        case IPPROTO_TCP:
+        case IPPROTO_UDP:
+            if(len < header_size + 4) { return 0; }
+            ports_swap_c(&(data[header_size]));
+            break;
+
+        default:
+            return 0;
+    }
+
+    /* switches the source and destination addresses so that
+    the packet is returned to the sender */
+    address = header->saddr;
+    header->saddr = header->daddr;
+    header->daddr = address;
+
+    return 1;
+}
+
+struct in6_addr *ndisc_target_c(unsigned char *data, unsigned int len) {
+    struct ipv6hdr *header = (struct ipv6hdr *) data;
+    struct nd_msg *message;
+    unsigned int header_size = sizeof(struct ipv6hdr);
+
+    /* verifies that the packet is a neighbor solicitation with
+    the hop limit set as required by the specification */
+    if(len < header_size + NDISC_MESSAGE_SIZE) { return NULL; }
+    if(header->version != 6 || header->nexthdr != IPPROTO_ICMPV6) { return NULL; }
+    if(header->hop_limit != 255) { return NULL; }
+    if(ntohs(header->payload_len) < NDISC_MESSAGE_SIZE) { return NULL; }
+
+    message = (struct nd_msg *) &(data[header_size]);
+    if(message->icmph.icmp6_type != NDISC_NEIGHBOUR_SOLICITATION) { return NULL; }
+    if(message->icmph.icmp6_code != 0) { return NULL; }
+
+    /* duplicate address detection solicitations (unspecified
+    source) must never be answered or the addresses of the
+    stack itself would be considered duplicated */
+    if(ipv6_addr_any(&header->saddr)) { return NULL; }
+    if(ipv6_addr_is_multicast(&message->target)) { return NULL; }
+
+    return &message->target;
+}
+
+int ndisc_reflect_c(unsigned char *data, unsigned int len, const unsigned char *mac) {
+    struct ipv6hdr *header = (struct ipv6hdr *) data;
+    struct nd_msg *message = (struct nd_msg *) &(data[sizeof(struct ipv6hdr)]);
+    unsigned char *option = message->opt;
+    unsigned int payload_size = ntohs(header->payload_len);
+    unsigned int message_size = NDISC_MESSAGE_SIZE;
+
+    /* verifies that the packet is a valid solicitation (that
+    may be answered) before any change is done to it */
+    if(ndisc_target_c(data, len) == NULL) { return 0; }
+
+    /* in case there's space for an option in the solicitation
+    (source link layer address) it's replaced with the target
+    link layer address, other options are discarded */
+    if(payload_size >= NDISC_MESSAGE_SIZE + NDISC_OPTION_SIZE &&
+        len >= sizeof(struct ipv6hdr) + NDISC_MESSAGE_SIZE + NDISC_OPTION_SIZE) {
+        option[0] = ND_OPT_TARGET_LL_ADDR;
+        option[1] = 1;
+        memcpy(&(option[2]), mac, MAC_ADDRESS_SIZE);
+        message_size += NDISC_OPTION_SIZE;
+    }
+
+    /* turns the solicitation into a solicited advertisement
+    overriding any previous cache entry for the target */
+    message->icmph.icmp6_type = NDISC_NEIGHBOUR_ADVERTISEMENT;
+    message->icmph.icmp6_dataun.un_data32[0] = 0;
+    ((unsigned char *) &message->icmph)[4] = NDISC_NA_FLAGS;
+
+    /* the advertisement is sent from the target address back
+    to the sender of the solicitation */
+    header->daddr = header->saddr;
+    header->saddr = message->target;
+    header->payload_len = htons(message_size);
+
+    /* computes the checksum of the message, the complete sum
+    is required as both addresses and contents have changed */
+    message->icmph.icmp6_cksum = 0;
+    message->icmph.icmp6_cksum = csum_ipv6_magic(
+        &header->saddr,
+        &header->daddr,
+        message_size,
+        IPPROTO_ICMPV6,
+        csum_partial(message, message_size, 0)
+    );
+
+    return 1;
+}
@@ -0,0 +1,128 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#pragma once
+
+#define ICMPV6_HEADER_SIZE 8
+#define NDISC_MESSAGE_SIZE 24
+#define NDISC_OPTION_SIZE 8
+#define NDISC_NA_FLAGS 0x60
+#define FLOW_TUPLE_SIZE 36
+
+/**
+ * Rewrites (in place) the provided ethernet header so that the
+ * frame is returned to its origin, the sender becomes the receiver
+ * and the provided mac address is set as the sender.
+ *
+ * @param mac_header The pointer to the start of the ethernet header.
+ * @param mac The link layer address of the responding device.
+ */
+void ethernet_reflect_c(unsigned char *mac_header, const unsigned char *mac);
+
+/**
+ * Rewrites (in place) the provided arp request into the reply
+ * for it, switching the sender and the target and announcing the
+ * provided mac address for every requested ip address.
+ *
+ * @param data The pointer to the start of the arp header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @param mac The link layer address to be announced.
+ * @return If the packet was rewritten into a reply (non zero)
+ * or if it's too small to be an arp packet (zero).
+ */
+int arp_reflect_c(unsigned char *data, unsigned int len, const unsigned char *mac);
+
+/**
+ * Extracts the flow tuple (addresses and ports) of the provided
+ * IPv4 or IPv6 packet into the tuple buffer in network order, the
+ * ports are only included for (non fragmented) tcp and udp.
+ *
+ * @param data The pointer to the start of the network header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @param protocol The (ethernet) protocol of the packet.
+ * @param tuple The buffer (of FLOW_TUPLE_SIZE bytes) for the tuple.
+ * @param ports Set with the information on the presence of ports.
+ * @return The number of bytes of the tuple, zero in case the
+ * packet is not an IPv4 or IPv6 one.
+ */
+unsigned int flow_tuple_c(unsigned char *data, unsigned int len, __be16 protocol, unsigned char *tuple, bool *ports);
+
+/**
+ * Rewrites (in place) the provided IPv4 packet into the response
+ * for it, swapping the addresses and the ports (checksum neutral)
+ * and turning echo requests into echo replies (incremental update
+ * of the checksum), the options are kept and the fragments are
+ * reflected individually (only the first one has the ports).
+ *
+ * @param data The pointer to the start of the IPv4 header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @return If the packet was rewritten into a response (non zero)
+ * or if it should not be reflected (zero), in which case the
+ * buffer is left untouched.
+ */
+int ipv4_reflect_c(unsigned char *data, unsigned int len);
+
+/**
+ * Rewrites (in place) the provided IPv6 packet into the response
+ * for it, swapping the addresses and the ports (checksum neutral)
+ * and turning ICMPv6 echo requests into echo replies (incremental
+ * update of the checksum).
+ *
+ * @param data The pointer to the start of the IPv6 header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @return If the packet was rewritten into a response (non zero)
+ * or if it should not be reflected (zero), in which case the
+ * buffer is left untouched.
+ */
+int ipv6_reflect_c(unsigned char *data, unsigned int len);
+
+/**
+ * Retrieves the target address of the neighbor solicitation
+ * contained in the provided IPv6 packet, duplicate address
+ * detection solicitations are not considered.
+ *
+ * @param data The pointer to the start of the IPv6 header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @return The pointer to the target address (inside the buffer)
+ * or NULL in case the packet is not a valid neighbor solicitation.
+ */
+struct in6_addr *ndisc_target_c(unsigned char *data, unsigned int len);
+
+/**
+ * Rewrites (in place) the provided neighbor solicitation into
+ * a (solicited) neighbor advertisement for the target address,
+ * announcing the provided mac address as the link layer address.
+ *
+ * The payload length of the IPv6 header is updated as extra
+ * options are discarded, the caller should trim the buffer.
+ *
+ * @param data The pointer to the start of the IPv6 header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @param mac The link layer address to be announced.
+ * @return If the packet was rewritten into an advertisement.
+ */
+int ndisc_reflect_c(unsigned char *data, unsigned int len, const unsigned char *mac);
@@ -0,0 +1,151 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#include "common.h"
+
+#include "net_responder.h"
+
+static DEFINE_HASHTABLE(responder_table, RESPONDER_HASH_BITS);
+static DEFINE_MUTEX(responder_lock);
+static atomic_t responder_count = ATOMIC_INIT(0);
+
+static inline u64 responder_key_c(__be16 ethertype, u8 protocol, __be16 port) {
+    return ((u64) ethertype << 24) | ((u64) protocol << 16) | (u64) port;
+}
+
+static struct dummy_responder *responder_lookup_c(__be16 ethertype, u8 protocol, __be16 port) {
+    struct dummy_responder *responder;
+    u64 key = responder_key_c(ethertype, protocol, port);
+
+    hash_for_each_possible_rcu(responder_table, responder, node, key) {
+        if(responder_key_c(responder->ethertype, responder->protocol, responder->port) == key) {
+            return responder;
+        }
+    }
+
+    return NULL;
+}
+
+static void responder_transport_c(struct sk_buff *skb, __be16 ethertype, u8 *protocol, __be16 *port) {
+    struct iphdr header_buffer;
+    struct ipv6hdr header6_buffer;
+    struct iphdr *header;
+    struct ipv6hdr *header6;
+    __be16 port_buffer;
+    __be16 *destination;
+    unsigned int offset;
+
+    /* reads the protocol and the destination port of the frame
+    (without pulling), only the first fragment has a port */
+    switch(ethertype) {
+        case htons(ETH_P_IP):
+            header = skb_header_pointer(skb, 0, sizeof(struct iphdr), &header_buffer);
+            if(header == NULL) { return; }
+            *protocol = header->protocol;
+            if(header->frag_off & htons(IP_OFFSET)) { return; }
+            offset = header->ihl * 4;
+            break;
+
+        case htons(ETH_P_IPV6):
+            header6 = skb_header_pointer(skb, 0, sizeof(struct ipv6hdr), &header6_buffer);
+            if(header6 == NULL) { return; }
+            *protocol = header6->nexthdr;
+            offset = sizeof(struct ipv6hdr);
+            break;
+
+        default:
+            return;
+    }
+
+    if(*protocol != IPPROTO_TCP && *protocol != IPPROTO_UDP) { return; }
+    destination = skb_header_pointer(skb, offset + 2, sizeof(__be16), &port_buffer);
+    if(destination != NULL) { *port = *destination; }
+}
+
+int dummy_responder_register(struct dummy_responder *responder) {
+    int error = 0;
+
+    mutex_lock(&responder_lock);
+    if(responder_lookup_c(responder->ethertype, responder->protocol, responder->port)) {
+        error = -EEXIST;
+    } else {
+        hash_add_rcu(
+            responder_table,
+            &responder->node,
+            responder_key_c(responder->ethertype, responder->protocol, responder->port)
+        );
+        atomic_inc(&responder_count);
+    }
+    mutex_unlock(&responder_lock);
+
+    return error;
+}
+EXPORT_SYMBOL_GPL(dummy_responder_register);
+
+void dummy_responder_unregister(struct dummy_responder *responder) {
+    mutex_lock(&responder_lock);
+    hash_del_rcu(&responder->node);
+    atomic_dec(&responder_count);
+    mutex_unlock(&responder_lock);
+
+    /* waits for the handlers that may be running (transmit
+    path) so that the responder may be released after */
+    synchronize_rcu();
+}
+EXPORT_SYMBOL_GPL(dummy_responder_unregister);
+
+bool dummy_responder_prepare(struct sk_buff *skb, unsigned int len) {
+    if(!pskb_may_pull(skb, len)) { return false; }
+    if(skb_cow_head(skb, 0)) { return false; }
+    return true;
+}
+EXPORT_SYMBOL_GPL(dummy_responder_prepare);
+
+int responder_dispatch_c(struct sk_buff *skb, struct net_device *dev, __be16 ethertype) {
+    struct dummy_responder *responder;
+    int verdict = DUMMY_VERDICT_PASS;
+    u8 protocol = 0;
+    __be16 port = 0;
+
+    /* avoids any work (no key extraction) in case there's no
+    responder registered, the common case for the driver */
+    if(atomic_read(&responder_count) == 0) { return verdict; }
+
+    /* looks up the most specific responder for the frame, from
+    the complete key to the ethernet type only (at most three
+    lookups in the table, constant time) */
+    responder_transport_c(skb, ethertype, &protocol, &port);
+
+    rcu_read_lock();
+    responder = responder_lookup_c(ethertype, protocol, port);
+    if(responder == NULL && port != 0) { responder = responder_lookup_c(ethertype, protocol, 0); }
+    if(responder == NULL && protocol != 0) { responder = responder_lookup_c(ethertype, 0, 0); }
+    if(responder != NULL) { verdict = responder->handler(skb, dev, responder->data); }
+    rcu_read_unlock();
+
+    return verdict;
+}
@@ -0,0 +1,103 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#pragma once
+
+#include <linux/netdevice.h>
+#include <linux/types.h>
+
+#define RESPONDER_HASH_BITS 8
+
+/**
+ * The verdicts of a responder handler, pass hands the frame
+ * back to the built in responders, reflect means that the frame
+ * was rewritten (in place) into the response and consume means
+ * that the handler took ownership of the frame.
+ */
+#define DUMMY_VERDICT_PASS 0
+#define DUMMY_VERDICT_REFLECT 1
+#define DUMMY_VERDICT_CONSUME 2
+
+/**
+ * Structure that defines a responder registered by another
+ * module, keyed by the ethernet type, the ip protocol and the
+ * destination port (zero matches any protocol or port).
+ *
+ * The handler is called (bottom halves disabled) with the data
+ * of the frame at the network header, in case it reflects the
+ * frame the mac addresses are switched by the driver.
+ */
+struct dummy_responder {
+    __be16 ethertype;
+    u8 protocol;
+    __be16 port;
+    int (*handler)(struct sk_buff *skb, struct net_device *dev, void *data);
+    void *data;
+    struct hlist_node node;
+};
+
+/**
+ * Registers the provided responder, frames with its key are
+ * handed to it before the built in responders of the driver.
+ *
+ * @param responder The responder to be registered, must remain
+ * valid until it's unregistered.
+ * @return The result of the registration, zero in case of success
+ * or -EEXIST in case a responder is registered for the key.
+ */
+int dummy_responder_register(struct dummy_responder *responder);
+
+/**
+ * Unregisters the provided responder, waiting for any running
+ * handler to complete (may sleep).
+ *
+ * @param responder The responder to be unregistered.
+ */
+void dummy_responder_unregister(struct dummy_responder *responder);
+
+/**
+ * Ensures that the provided number of bytes (from the network
+ * header) are linear and writable, to be used by the handlers
+ * before rewriting the frame in place.
+ *
+ * @param skb The frame to be prepared.
+ * @param len The number of bytes to be made writable.
+ * @return If the bytes are available for writing.
+ */
+bool dummy_responder_prepare(struct sk_buff *skb, unsigned int len);
+
+/**
+ * Dispatches the provided frame to the registered responder
+ * (the most specific one) for its key, constant time lookup.
+ *
+ * @param skb The frame, with the data at the network header.
+ * @param dev The device that transmitted the frame.
+ * @param ethertype The (inner) ethernet type of the frame.
+ * @return The verdict of the responder, pass in case there's
+ * no responder registered for the frame.
+ */
+int responder_dispatch_c(struct sk_buff *skb, struct net_device *dev, __be16 ethertype);
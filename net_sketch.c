@@ -0,0 +1,369 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#include "common.h"
+
+#include "net_proto.h"
+#include "net_sketch.h"
+
+/**
+ * Structure that defines the sketches of a cpu, a single
+ * block with a table per protocol and kind of key.
+ */
+struct sketch_cpu {
+    unsigned char *tables;
+    unsigned int generation;
+};
+
+static DEFINE_PER_CPU(struct sketch_cpu, sketch_cpus);
+
+static const char *sketch_protocols[SKETCH_PROTOCOLS] = { "tcp", "udp", "icmp", "other" };
+static const char *sketch_kinds[SKETCH_KINDS] = { "flow", "source" };
+
+static unsigned int sketch_width;
+static unsigned long sketch_stride;
+static u32 sketch_seeds[2];
+static atomic_t sketch_generation = ATOMIC_INIT(0);
+
+static inline struct sketch_table *sketch_table_c(unsigned char *tables, unsigned int protocol, unsigned int kind) {
+    return (struct sketch_table *) (tables + (protocol * SKETCH_KINDS + kind) * sketch_stride);
+}
+
+static inline unsigned int sketch_index_c(u32 hash, u32 step, unsigned int row) {
+    return row * sketch_width + ((hash + row * step) & (sketch_width - 1));
+}
+
+static void sketch_down_c(struct sketch_table *table, unsigned int index) {
+    struct sketch_entry entry;
+    unsigned int child;
+
+    /* moves the entry down the (min) heap while any of its
+    children has a smaller count than the entry */
+    while((child = index * 2 + 1) < table->top_count) {
+        if(child + 1 < table->top_count && table->top[child + 1].count < table->top[child].count) { child++; }
+        if(table->top[index].count <= table->top[child].count) { break; }
+        entry = table->top[index];
+        table->top[index] = table->top[child];
+        table->top[child] = entry;
+        index = child;
+    }
+}
+
+static void sketch_up_c(struct sketch_table *table, unsigned int index) {
+    struct sketch_entry entry;
+    unsigned int parent;
+
+    while(index > 0) {
+        parent = (index - 1) / 2;
+        if(table->top[parent].count <= table->top[index].count) { break; }
+        entry = table->top[index];
+        table->top[index] = table->top[parent];
+        table->top[parent] = entry;
+        index = parent;
+    }
+}
+
+static void sketch_add_c(struct sketch_table *table, unsigned char *key, unsigned int size) {
+    struct sketch_entry *entry;
+    u64 estimate = U64_MAX;
+    u32 hash = jhash(key, size, sketch_seeds[0]);
+    u32 step = jhash(key, size, sketch_seeds[1]) | 1;
+    unsigned int index;
+
+    /* increments the counter of the key in each of the rows (the
+    row index is derived from two hashes) the estimate for the key
+    is the minimum of these counters */
+    for(index = 0; index < SKETCH_DEPTH; index++) {
+        u64 *counter = &table->counters[sketch_index_c(hash, step, index)];
+        (*counter)++;
+        estimate = min(estimate, *counter);
+    }
+    table->total++;
+
+    /* in case the key is already in the top heap only its count
+    is updated, the count never decreases so the entry can only
+    move down the (min) heap, the scan is bounded by the heap size */
+    for(index = 0; index < table->top_count; index++) {
+        entry = &table->top[index];
+        if(entry->hash != hash || entry->size != size) { continue; }
+        if(memcmp(entry->key, key, size)) { continue; }
+        entry->count = estimate;
+        sketch_down_c(table, index);
+        return;
+    }
+
+    /* adds the key to the heap in case there's space available
+    or replaces the smallest entry in case the key is larger */
+    if(table->top_count < SKETCH_TOP) {
+        index = table->top_count++;
+    } else if(estimate > table->top[0].count) {
+        index = 0;
+    } else {
+        return;
+    }
+
+    entry = &table->top[index];
+    entry->count = estimate;
+    entry->hash = hash;
+    entry->size = size;
+    memcpy(entry->key, key, size);
+    if(index == 0) { sketch_down_c(table, 0); } else { sketch_up_c(table, index); }
+}
+
+static inline bool sketch_current_c(struct sketch_cpu *sketch) {
+    /* the sketches of a cpu that has not been updated since the
+    last reset are stale (cleared only on its next update) */
+    return ACCESS_ONCE(sketch->generation) == atomic_read(&sketch_generation);
+}
+
+static u64 sketch_estimate_c(unsigned int protocol, unsigned int kind, struct sketch_entry *entry) {
+    struct sketch_cpu *sketch;
+    u64 estimate = U64_MAX;
+    u64 sum;
+    u32 step = jhash(entry->key, entry->size, sketch_seeds[1]) | 1;
+    unsigned int index;
+    int cpu;
+
+    /* the sketches of the cpus are merged (added cell by cell)
+    so that the estimate is the minimum of the merged rows */
+    for(index = 0; index < SKETCH_DEPTH; index++) {
+        sum = 0;
+        for_each_possible_cpu(cpu) {
+            sketch = per_cpu_ptr(&sketch_cpus, cpu);
+            if(!sketch_current_c(sketch)) { continue; }
+            sum += ACCESS_ONCE(sketch_table_c(sketch->tables, protocol, kind)->counters[
+                sketch_index_c(entry->hash, step, index)]);
+        }
+        estimate = min(estimate, sum);
+    }
+
+    return estimate;
+}
+
+static void sketch_print_c(struct seq_file *file, struct sketch_entry *entry) {
+    unsigned char *key = entry->key;
+
+    /* prints the key according to its size, that identifies
+    the kind of key and the family of the addresses */
+    switch(entry->size) {
+        case 4:
+            seq_printf(file, "%pI4", key);
+            break;
+        case 8:
+            seq_printf(file, "%pI4 > %pI4", key, &key[4]);
+            break;
+        case 12:
+            seq_printf(file, "%pI4:%u > %pI4:%u", key, get_unaligned_be16(&key[8]),
+                &key[4], get_unaligned_be16(&key[10]));
+            break;
+        case 16:
+            seq_printf(file, "%pI6c", key);
+            break;
+        case 32:
+            seq_printf(file, "%pI6c > %pI6c", key, &key[16]);
+            break;
+        case 36:
+            seq_printf(file, "[%pI6c]:%u > [%pI6c]:%u", key, get_unaligned_be16(&key[32]),
+                &key[16], get_unaligned_be16(&key[34]));
+            break;
+    }
+}
+
+static int sketch_show_c(struct seq_file *file, void *data) {
+    struct sketch_entry *top;
+    struct sketch_entry *entry;
+    struct sketch_table *table;
+    struct sketch_cpu *sketch;
+    unsigned int protocol;
+    unsigned int kind;
+    unsigned int count;
+    unsigned int index;
+    unsigned int position;
+    u64 total;
+    u64 estimate;
+    int cpu;
+
+    top = kmalloc(sizeof(struct sketch_entry) * SKETCH_TOP, GFP_KERNEL);
+    if(top == NULL) { return -ENOMEM; }
+
+    for(protocol = 0; protocol < SKETCH_PROTOCOLS; protocol++) {
+        for(kind = 0; kind < SKETCH_KINDS; kind++) {
+            total = 0;
+            count = 0;
+
+            /* the candidates are the top entries of each of the cpus,
+            their (merged) estimates are sorted into the top entries,
+            a duplicated candidate has the same estimate so it's only
+            compared against the entries already in the top */
+            for_each_possible_cpu(cpu) {
+                sketch = per_cpu_ptr(&sketch_cpus, cpu);
+                if(!sketch_current_c(sketch)) { continue; }
+                table = sketch_table_c(sketch->tables, protocol, kind);
+                total += ACCESS_ONCE(table->total);
+
+                for(index = 0; index < min_t(unsigned int, ACCESS_ONCE(table->top_count), SKETCH_TOP); index++) {
+                    entry = &table->top[index];
+                    if(entry->size == 0 || entry->size > SKETCH_KEY_SIZE) { continue; }
+                    for(position = 0; position < count; position++) {
+                        if(top[position].size == entry->size && !memcmp(top[position].key, entry->key, entry->size)) { break; }
+                    }
+                    if(position < count) { continue; }
+
+                    estimate = sketch_estimate_c(protocol, kind, entry);
+                    for(position = count; position > 0 && top[position - 1].count < estimate; position--) {
+                        if(position < SKETCH_TOP) { top[position] = top[position - 1]; }
+                    }
+                    if(position >= SKETCH_TOP) { continue; }
+                    top[position] = *entry;
+                    top[position].count = estimate;
+                    if(count < SKETCH_TOP) { count++; }
+                }
+            }
+
+            seq_printf(file, "%s %s total %llu\n", sketch_protocols[protocol], sketch_kinds[kind], total);
+            for(position = 0; position < count; position++) {
+                seq_printf(file, "%s %s ", sketch_protocols[protocol], sketch_kinds[kind]);
+                sketch_print_c(file, &top[position]);
+                seq_printf(file, " %llu\n", top[position].count);
+            }
+        }
+    }
+
+    kfree(top);
+    return 0;
+}
+
+static int sketch_open_c(struct inode *inode, struct file *file) {
+    return single_open(file, sketch_show_c, inode->i_private);
+}
+
+static ssize_t sketch_write_c(struct file *file, const char __user *buffer, size_t count, loff_t *position) {
+    /* any write resets the sketches, each of the cpus clears its
+    own sketches on its next update (no writer is interrupted)
+    and until then its sketches are ignored by the queries */
+    atomic_inc(&sketch_generation);
+    return count;
+}
+
+static const struct file_operations sketch_fops = {
+    .owner = THIS_MODULE,
+    .open = sketch_open_c,
+    .read = seq_read,
+    .write = sketch_write_c,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+int sketch_init_c(struct dentry *root, unsigned int width) {
+    struct sketch_cpu *sketch;
+    int cpu;
+
+    /* in case no width is requested the sketches are disabled
+    and no memory is allocated for them */
+    if(width == 0) { return 0; }
+
+    /* the width is rounded to a power of two so that the index
+    in the row is computed with a mask, each of the tables is
+    aligned to the cache line size */
+    sketch_width = roundup_pow_of_two(width);
+    sketch_stride = ALIGN(sizeof(struct sketch_table) + SKETCH_DEPTH * sketch_width * sizeof(u64), SMP_CACHE_BYTES);
+    get_random_bytes(sketch_seeds, sizeof(sketch_seeds));
+
+    for_each_possible_cpu(cpu) {
+        sketch = per_cpu_ptr(&sketch_cpus, cpu);
+        sketch->tables = vzalloc_node(SKETCH_PROTOCOLS * SKETCH_KINDS * sketch_stride, cpu_to_node(cpu));
+        if(sketch->tables == NULL) { sketch_destroy_c(); return -ENOMEM; }
+    }
+
+    /* creates the file through which the heavy hitters are queried
+    (and the sketches reset), a failure is not fatal */
+    debugfs_create_file("sketch", 0600, root, NULL, &sketch_fops);
+    return 0;
+}
+
+void sketch_destroy_c(void) {
+    struct sketch_cpu *sketch;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        sketch = per_cpu_ptr(&sketch_cpus, cpu);
+        vfree(sketch->tables);
+        sketch->tables = NULL;
+    }
+
+    sketch_width = 0;
+}
+
+void sketch_update_c(unsigned char *data, unsigned int len, __be16 protocol) {
+    struct sketch_cpu *sketch = this_cpu_ptr(&sketch_cpus);
+    unsigned char tuple[FLOW_TUPLE_SIZE];
+    unsigned int tuple_size;
+    unsigned int generation;
+    unsigned int index;
+    bool ports;
+    u8 transport;
+
+    if(sketch->tables == NULL) { return; }
+
+    /* in case a reset was requested since the last update of the
+    current cpu its sketches are cleared before being updated */
+    generation = atomic_read(&sketch_generation);
+    if(unlikely(sketch->generation != generation)) {
+        memset(sketch->tables, 0, SKETCH_PROTOCOLS * SKETCH_KINDS * sketch_stride);
+        sketch->generation = generation;
+    }
+
+    /* extracts the flow tuple of the packet, only ip packets are
+    tracked, the source address is the start of the tuple */
+    tuple_size = flow_tuple_c(data, len, protocol, tuple, &ports);
+    if(tuple_size == 0) { return; }
+
+    transport = protocol == htons(ETH_P_IP) ?
+        ((struct iphdr *) data)->protocol : ((struct ipv6hdr *) data)->nexthdr;
+    switch(transport) {
+        case IPPROTO_TCP:
+            index = SKETCH_PROTOCOL_TCP;
+            break;
+        case IPPROTO_UDP:
+            index = SKETCH_PROTOCOL_UDP;
+            break;
+        case IPPROTO_ICMP:
+        case IPPROTO_ICMPV6:
+            index = SKETCH_PROTOCOL_ICMP;
+            break;
+        default:
+            index = SKETCH_PROTOCOL_OTHER;
+            break;
+    }
+
+    sketch_add_c(sketch_table_c(sketch->tables, index, SKETCH_KIND_FLOW), tuple, tuple_size);
+    sketch_add_c(
+        sketch_table_c(sketch->tables, index, SKETCH_KIND_SOURCE),
+        tuple,
+        protocol == htons(ETH_P_IP) ? IP_ADDRESS_SIZE : sizeof(struct in6_addr)
+    );
+}
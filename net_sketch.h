@@ -0,0 +1,98 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#pragma once
+
+#define SKETCH_DEPTH 4
+#define SKETCH_TOP 16
+#define SKETCH_KEY_SIZE 36
+
+#define SKETCH_PROTOCOL_TCP 0
+#define SKETCH_PROTOCOL_UDP 1
+#define SKETCH_PROTOCOL_ICMP 2
+#define SKETCH_PROTOCOL_OTHER 3
+#define SKETCH_PROTOCOLS 4
+
+#define SKETCH_KIND_FLOW 0
+#define SKETCH_KIND_SOURCE 1
+#define SKETCH_KINDS 2
+
+/**
+ * Structure that defines an entry of the top (heavy hitters)
+ * heap of a sketch, the key is either the flow tuple or the
+ * source address (as extracted from the packet).
+ */
+struct sketch_entry {
+    u64 count;
+    u32 hash;
+    u8 size;
+    u8 key[SKETCH_KEY_SIZE];
+};
+
+/**
+ * Structure that defines a count-min sketch (of a protocol
+ * and kind of key) of a cpu, the counters (depth rows of
+ * width counters) follow the structure, the top entries are
+ * kept in a min heap ordered by the estimated count.
+ */
+struct sketch_table {
+    u64 total;
+    unsigned int top_count;
+    struct sketch_entry top[SKETCH_TOP];
+    u64 counters[0];
+};
+
+/**
+ * Allocates the per cpu sketches and creates the debugfs
+ * file through which the heavy hitters are queried.
+ *
+ * @param root The debugfs directory to create the file in.
+ * @param width The number of counters of each row of the
+ * sketches (power of two), zero disables the sketches.
+ * @return The result of the initialization, zero in case of
+ * success and a negative error code otherwise.
+ */
+int sketch_init_c(struct dentry *root, unsigned int width);
+
+/**
+ * Releases the per cpu sketches, should be called only
+ * after the debugfs file has been removed.
+ */
+void sketch_destroy_c(void);
+
+/**
+ * Updates the sketches of the current cpu with the provided
+ * packet (flow and source address), the cost is constant and
+ * independent of the number of flows.
+ *
+ * Must be called with bottom halves disabled (single writer).
+ *
+ * @param data The pointer to the start of the network header.
+ * @param len The number of (linear) bytes available in the buffer.
+ * @param protocol The (ethernet) protocol of the packet.
+ */
+void sketch_update_c(unsigned char *data, unsigned int len, __be16 protocol);
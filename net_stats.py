@@ -0,0 +1,139 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Hive Drivers
+# Copyright (c) 2008-2015 Hive Solutions Lda.
+#
+# This file is part of Hive Drivers.
+#
+# Hive Drivers is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Hive Drivers is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+__author__ = "João Magalhães <joamag@hive.pt>"
+""" The author(s) of the module """
+
+__version__ = "1.0.0"
+""" The version of the module """
+
+__revision__ = "$LastChangedRevision$"
+""" The revision number of the module """
+
+__date__ = "$LastChangedDate$"
+""" The last change date of the module """
+
+__copyright__ = "Copyright (c) 2008-2015 Hive Solutions Lda."
+""" The copyright for the module """
+
+__license__ = "GNU General Public License (GPL), Version 3"
+""" The license for the module """
+
+import os
+import sys
+import mmap
+import time
+import struct
+
+STATS_PATH = "/sys/kernel/debug/net_dummy/%s/stats_page"
+""" The path to the debugfs file that contains the memory
+mapped statistics page of a device (by name) """
+
+STATS_MAGIC = 0x44535441
+""" The magic value that identifies a valid statistics page """
+
+HEADER_FORMAT = "=IIIIIIQQ"
+""" The format of the header of a statistics page, must
+be kept in sync with the dummy_stats_header structure """
+
+EVENTS = (
+    "rx_drop_queue_full",
+    "rx_drop_no_memory",
+    "tx_unanswered",
+    "tx_queue_stops",
+    "tx_mirror_drops",
+    "tx_peer_drops"
+)
+""" The names of the events counted by the devices, in the
+order of their identifiers (as in ethtool -S) """
+
+class Page(object):
+
+    def __init__(self, path):
+        self.path = path
+        self.file = open(path, "rb")
+        self.map = mmap.mmap(self.file.fileno(), mmap.PAGESIZE, mmap.MAP_SHARED, mmap.PROT_READ)
+        header = struct.unpack_from(HEADER_FORMAT, self.map, 0)
+        magic, _version, _sequence, self.cpus, self.events, _usecs, _timestamp, _publications = header
+        if not magic == STATS_MAGIC: raise RuntimeError("Invalid statistics page '%s'" % path)
+        self.counters_format = "=%dQ" % (4 + self.events)
+        self.remap()
+
+    def remap(self):
+        # re-maps the page with the complete size (header and the
+        # counters of all of the cpus) as debugfs has no size information
+        size = struct.calcsize(HEADER_FORMAT) + struct.calcsize(self.counters_format) * (self.cpus + 1)
+        size = (size + mmap.PAGESIZE - 1) // mmap.PAGESIZE * mmap.PAGESIZE
+        self.map.close()
+        self.map = mmap.mmap(self.file.fileno(), size, mmap.MAP_SHARED, mmap.PROT_READ)
+
+    def read(self):
+        # reads a consistent snapshot of the page, retrying in case
+        # the sequence is odd (being written) or changed while copying
+        while True:
+            sequence = struct.unpack_from("=I", self.map, 8)[0]
+            if sequence & 1: continue
+            data = self.map[:]
+            if struct.unpack_from("=I", self.map, 8)[0] == sequence: break
+
+        header = struct.unpack_from(HEADER_FORMAT, data, 0)
+        offset = struct.calcsize(HEADER_FORMAT)
+        step = struct.calcsize(self.counters_format)
+        counters = [
+            struct.unpack_from(self.counters_format, data, offset + index * step)
+            for index in range(self.cpus + 1)
+        ]
+        return header, counters[0], counters[1:]
+
+def main():
+    # retrieves the name of the device and the interval between
+    # the reports, by default the first dummy device is used
+    name = sys.argv[1] if len(sys.argv) > 1 else "dummy0"
+    interval = float(sys.argv[2]) if len(sys.argv) > 2 else 1.0
+
+    page = Page(STATS_PATH % name)
+    previous, previous_total, _cpus = page.read()
+
+    try:
+        while True:
+            time.sleep(interval)
+            header, total, cpus = page.read()
+            elapsed = (header[6] - previous[6]) / 1e9 or interval
+            rates = [(current - last) / elapsed for current, last in zip(total, previous_total)]
+            sys.stdout.write(
+                "rx %d pps %d bps tx %d pps %d bps (%d publications)\n" % (
+                    rates[0], rates[2] * 8, rates[1], rates[3] * 8, header[7] - previous[7]
+                )
+            )
+            for index, count in enumerate(total[4:]):
+                if not count: continue
+                event = EVENTS[index] if index < len(EVENTS) else str(index)
+                sys.stdout.write("    %s %d\n" % (event, count))
+            for cpu, counters in enumerate(cpus):
+                if not counters[0] and not counters[1]: continue
+                sys.stdout.write("    cpu%d rx %d tx %d\n" % (cpu, counters[0], counters[1]))
+            sys.stdout.flush()
+            previous, previous_total = header, total
+    except KeyboardInterrupt:
+        pass
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,470 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#include "common.h"
+
+#include "net_proto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+#include <linux/io_uring.h>
+
+/* the userspace twin of the driver, answers the frames written
+into a tap device by the kernel with the same protocol code used
+by the module, using io_uring for batched (syscall free) reads
+and writes of the frames over a set of registered buffers */
+
+#define TAP_BUFFERS 256
+#define TAP_BUFFER_SIZE 9216
+#define TAP_RING_SIZE (TAP_BUFFERS * 2)
+#define TAP_GROUP 0
+
+#define TAP_OP_READ 0
+#define TAP_OP_WRITE 1
+#define TAP_DATA(op, index) (((u64) (op) << 32) | (index))
+#define TAP_DATA_OP(data) ((u32) ((data) >> 32))
+#define TAP_DATA_INDEX(data) ((u32) (data))
+
+#ifndef IORING_OP_READ_MULTISHOT
+#define IORING_OP_READ_MULTISHOT 49
+#endif
+
+/**
+ * Structure that defines the state of the (userspace) twin,
+ * the rings shared with the kernel and the frame buffers.
+ */
+struct tap {
+    int fd;
+    int ring;
+    unsigned char mac[MAC_ADDRESS_SIZE];
+    unsigned char *buffers;
+    struct io_uring_buf_ring *buffer_ring;
+    bool multishot;
+    bool armed;
+    unsigned int available;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned int sq_pending;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+    u64 rx_packets;
+    u64 tx_packets;
+    u64 dropped;
+    u64 errors;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void tap_signal(int signal __attribute__((unused))) {
+    running = 0;
+}
+
+static int tap_setup(unsigned int entries, struct io_uring_params *params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int tap_enter(int ring, unsigned int submit, unsigned int complete, unsigned int flags) {
+    return (int) syscall(__NR_io_uring_enter, ring, submit, complete, flags, NULL, 0);
+}
+
+static int tap_register(int ring, unsigned int opcode, void *arg, unsigned int count) {
+    return (int) syscall(__NR_io_uring_register, ring, opcode, arg, count);
+}
+
+static unsigned char *tap_buffer(struct tap *tap, unsigned int index) {
+    return tap->buffers + (size_t) index * TAP_BUFFER_SIZE;
+}
+
+static struct io_uring_sqe *tap_sqe(struct tap *tap) {
+    unsigned int head = __atomic_load_n(tap->sq_head, __ATOMIC_ACQUIRE);
+    unsigned int tail = *tap->sq_tail + tap->sq_pending;
+    unsigned int index;
+
+    /* the submission ring is sized so that it can hold an entry
+    for every buffer, running out of entries is a logic error */
+    if(tail - head > *tap->sq_mask) { return NULL; }
+    index = tail & *tap->sq_mask;
+    tap->sq_array[index] = index;
+    tap->sq_pending++;
+    memset(&tap->sqes[index], 0, sizeof(struct io_uring_sqe));
+    return &tap->sqes[index];
+}
+
+static unsigned int tap_flush(struct tap *tap) {
+    /* publishes the pending entries to the kernel, the release
+    store orders the writes of the entries before the tail */
+    unsigned int tail = *tap->sq_tail + tap->sq_pending;
+    __atomic_store_n(tap->sq_tail, tail, __ATOMIC_RELEASE);
+    tap->sq_pending = 0;
+
+    /* returns the number of published entries that are still
+    to be consumed (submitted) by the kernel */
+    return tail - __atomic_load_n(tap->sq_head, __ATOMIC_ACQUIRE);
+}
+
+static void tap_read(struct tap *tap, unsigned int index) {
+    struct io_uring_sqe *sqe;
+
+    /* in case the multishot read is in use the buffer is given back
+    to the provided ring (to be picked by the kernel) otherwise a
+    read of a single frame is submitted for the (fixed) buffer */
+    if(tap->multishot) {
+        struct io_uring_buf *buffer;
+        unsigned short tail = tap->buffer_ring->tail;
+
+        buffer = &tap->buffer_ring->bufs[tail & (TAP_BUFFERS - 1)];
+        buffer->addr = (u64) (uintptr_t) tap_buffer(tap, index);
+        buffer->len = TAP_BUFFER_SIZE;
+        buffer->bid = index;
+        __atomic_store_n(&tap->buffer_ring->tail, tail + 1, __ATOMIC_RELEASE);
+        tap->available++;
+        return;
+    }
+
+    sqe = tap_sqe(tap);
+    if(sqe == NULL) { return; }
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = tap->fd;
+    sqe->addr = (u64) (uintptr_t) tap_buffer(tap, index);
+    sqe->len = TAP_BUFFER_SIZE;
+    sqe->buf_index = 0;
+    sqe->user_data = TAP_DATA(TAP_OP_READ, index);
+}
+
+static void tap_arm(struct tap *tap) {
+    struct io_uring_sqe *sqe;
+
+    /* (re-)arms the multishot read, that keeps on posting a
+    completion per frame while there are provided buffers */
+    if(tap->armed || tap->available == 0) { return; }
+    sqe = tap_sqe(tap);
+    if(sqe == NULL) { return; }
+    sqe->opcode = IORING_OP_READ_MULTISHOT;
+    sqe->fd = tap->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = TAP_GROUP;
+    sqe->user_data = TAP_DATA(TAP_OP_READ, TAP_BUFFERS);
+    tap->armed = true;
+}
+
+static void tap_write(struct tap *tap, unsigned int index, unsigned int len) {
+    struct io_uring_sqe *sqe = tap_sqe(tap);
+    if(sqe == NULL) { tap_read(tap, index); return; }
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = tap->fd;
+    sqe->addr = (u64) (uintptr_t) tap_buffer(tap, index);
+    sqe->len = len;
+    sqe->buf_index = 0;
+    sqe->user_data = TAP_DATA(TAP_OP_WRITE, index);
+}
+
+static unsigned int tap_reflect(struct tap *tap, unsigned char *mac_header, unsigned int len) {
+    unsigned char *data = &(mac_header[ETH_HLEN]);
+    unsigned int data_len;
+
+    /* ensures that the complete ethernet header is available
+    and then dispatches the frame by its (ethernet) protocol,
+    using the same responders as the kernel module */
+    if(len < ETH_HLEN) { return 0; }
+    data_len = len - ETH_HLEN;
+
+    if(IS_ARP_REQUEST(mac_header)) {
+        if(!arp_reflect_c(data, data_len, tap->mac)) { return 0; }
+    } else if(IS_IP_REQUEST(mac_header)) {
+        if(!ipv4_reflect_c(data, data_len)) { return 0; }
+    } else if(IS_IPV6_REQUEST(mac_header)) {
+        if(ndisc_target_c(data, data_len) != NULL) {
+            if(!ndisc_reflect_c(data, data_len, tap->mac)) { return 0; }
+
+            /* trims the frame to the size of the advertisement
+            (options from the solicitation are discarded) */
+            len = ETH_HLEN + sizeof(struct ipv6hdr) +
+                ntohs(((struct ipv6hdr *) data)->payload_len);
+        } else if(!ipv6_reflect_c(data, data_len)) {
+            return 0;
+        }
+    } else {
+        return 0;
+    }
+
+    /* ensures the mac address header so that the frame
+    is returned to the origin */
+    ethernet_reflect_c(mac_header, tap->mac);
+    return len;
+}
+
+static bool tap_fatal(int result) {
+    /* only the transient errors allow the reads to be retried,
+    any other one (eg: device removed) stops the twin */
+    return result < 0 && result != -EAGAIN && result != -EINTR && result != -ENOBUFS;
+}
+
+static void tap_complete(struct tap *tap, struct io_uring_cqe *cqe) {
+    unsigned int op = TAP_DATA_OP(cqe->user_data);
+    unsigned int index = TAP_DATA_INDEX(cqe->user_data);
+    unsigned int len;
+
+    if(op == TAP_OP_WRITE) {
+        if(cqe->res < 0) { tap->errors++; } else { tap->tx_packets++; }
+        tap_read(tap, index);
+        return;
+    }
+
+    /* for the multishot read the buffer is the one selected by
+    the kernel and the read must be re-armed once it terminates */
+    if(tap->multishot) {
+        if(!(cqe->flags & IORING_CQE_F_MORE)) { tap->armed = false; }
+        if(!(cqe->flags & IORING_CQE_F_BUFFER)) {
+            if(tap_fatal(cqe->res)) { tap->errors++; running = 0; }
+            return;
+        }
+        index = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        tap->available--;
+    }
+
+    if(cqe->res <= 0) {
+        if(tap_fatal(cqe->res)) { tap->errors++; running = 0; }
+        tap_read(tap, index);
+        return;
+    }
+
+    /* rewrites the frame in place into the response and writes
+    it back from the same (registered) buffer, the buffer is only
+    reused for reading once the write is completed */
+    tap->rx_packets++;
+    len = tap_reflect(tap, tap_buffer(tap, index), (unsigned int) cqe->res);
+    if(len == 0) { tap->dropped++; tap_read(tap, index); return; }
+    tap_write(tap, index, len);
+}
+
+static bool tap_probe(struct tap *tap) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    bool supported;
+
+    /* verifies if the running kernel supports the multishot read
+    otherwise the batched reads of fixed buffers are used */
+    if(probe == NULL) { return false; }
+    if(tap_register(tap->ring, IORING_REGISTER_PROBE, probe, 256) < 0) { free(probe); return false; }
+    supported = probe->last_op >= IORING_OP_READ_MULTISHOT &&
+        (probe->ops[IORING_OP_READ_MULTISHOT].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return supported;
+}
+
+static int tap_open(struct tap *tap, const char *name) {
+    struct ifreq request;
+    int fd;
+
+    /* the device is opened in blocking mode so that the reads
+    (either multishot or fixed buffer ones) wait in the ring for
+    a frame (poll armed) instead of completing with -EAGAIN */
+    fd = open("/dev/net/tun", O_RDWR);
+    if(fd < 0) { return -1; }
+
+    memset(&request, 0, sizeof(request));
+    request.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(request.ifr_name, name, IFNAMSIZ - 1);
+    if(ioctl(fd, TUNSETIFF, &request) < 0) { close(fd); return -1; }
+
+    tap->fd = fd;
+    return 0;
+}
+
+static int tap_init(struct tap *tap) {
+    struct io_uring_params params;
+    struct io_uring_buf_reg buffer_reg;
+    struct iovec iovec;
+    unsigned char *sq_ring;
+    unsigned char *cq_ring;
+    size_t sq_size;
+    size_t cq_size;
+    unsigned int index;
+
+    memset(&params, 0, sizeof(params));
+    tap->ring = tap_setup(TAP_RING_SIZE, &params);
+    if(tap->ring < 0) { return -1; }
+
+    /* maps the submission and completion rings (a single mapping
+    in case the kernel supports it) and the submission entries */
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(cq_size > sq_size) { sq_size = cq_size; }
+        cq_size = sq_size;
+    }
+    sq_ring = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        tap->ring, IORING_OFF_SQ_RING);
+    if(sq_ring == MAP_FAILED) { return -1; }
+    cq_ring = sq_ring;
+    if(!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        cq_ring = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            tap->ring, IORING_OFF_CQ_RING);
+        if(cq_ring == MAP_FAILED) { return -1; }
+    }
+    tap->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, tap->ring, IORING_OFF_SQES);
+    if(tap->sqes == MAP_FAILED) { return -1; }
+
+    tap->sq_head = (unsigned int *) (sq_ring + params.sq_off.head);
+    tap->sq_tail = (unsigned int *) (sq_ring + params.sq_off.tail);
+    tap->sq_mask = (unsigned int *) (sq_ring + params.sq_off.ring_mask);
+    tap->sq_array = (unsigned int *) (sq_ring + params.sq_off.array);
+    tap->cq_head = (unsigned int *) (cq_ring + params.cq_off.head);
+    tap->cq_tail = (unsigned int *) (cq_ring + params.cq_off.tail);
+    tap->cq_mask = (unsigned int *) (cq_ring + params.cq_off.ring_mask);
+    tap->cqes = (struct io_uring_cqe *) (cq_ring + params.cq_off.cqes);
+
+    /* allocates the frame buffers as a single region registered
+    (pinned) once so that no per frame mapping is required */
+    tap->buffers = mmap(NULL, (size_t) TAP_BUFFERS * TAP_BUFFER_SIZE,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if(tap->buffers == MAP_FAILED) { return -1; }
+    iovec.iov_base = tap->buffers;
+    iovec.iov_len = (size_t) TAP_BUFFERS * TAP_BUFFER_SIZE;
+    if(tap_register(tap->ring, IORING_REGISTER_BUFFERS, &iovec, 1) < 0) { return -1; }
+
+    /* registers the ring of provided buffers from which the
+    multishot read selects a buffer for each of the frames */
+    tap->multishot = tap_probe(tap);
+    if(tap->multishot) {
+        tap->buffer_ring = mmap(NULL, TAP_BUFFERS * sizeof(struct io_uring_buf),
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(tap->buffer_ring == MAP_FAILED) { return -1; }
+        memset(&buffer_reg, 0, sizeof(buffer_reg));
+        buffer_reg.ring_addr = (u64) (uintptr_t) tap->buffer_ring;
+        buffer_reg.ring_entries = TAP_BUFFERS;
+        buffer_reg.bgid = TAP_GROUP;
+        if(tap_register(tap->ring, IORING_REGISTER_PBUF_RING, &buffer_reg, 1) < 0) {
+            tap->multishot = false;
+        }
+    }
+
+    for(index = 0; index < TAP_BUFFERS; index++) { tap_read(tap, index); }
+    return 0;
+}
+
+static void tap_run(struct tap *tap) {
+    unsigned int submit;
+    unsigned int head;
+    unsigned int tail;
+
+    while(running) {
+        /* submits every pending entry (reads and writes) in a
+        single call that also waits for at least one completion */
+        tap_arm(tap);
+        submit = tap_flush(tap);
+        if(tap_enter(tap->ring, submit, 1, IORING_ENTER_GETEVENTS) < 0) {
+            if(errno == EINTR) { continue; }
+            perror("io_uring_enter");
+            return;
+        }
+
+        /* consumes all the available completions, the head is only
+        released after the entries have been processed */
+        head = *tap->cq_head;
+        tail = __atomic_load_n(tap->cq_tail, __ATOMIC_ACQUIRE);
+        while(head != tail) {
+            tap_complete(tap, &tap->cqes[head & *tap->cq_mask]);
+            head++;
+        }
+        __atomic_store_n(tap->cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+static int tap_mac(const char *value, unsigned char *mac) {
+    unsigned int bytes[MAC_ADDRESS_SIZE];
+    int index;
+
+    if(sscanf(value, "%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1], &bytes[2],
+        &bytes[3], &bytes[4], &bytes[5]) != MAC_ADDRESS_SIZE) { return -1; }
+    for(index = 0; index < MAC_ADDRESS_SIZE; index++) { mac[index] = (unsigned char) bytes[index]; }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    struct tap tap;
+    const char *name = "tap0";
+    int option;
+
+    /* the default address is a random (locally administered
+    and unicast) one, as done for the dummy devices */
+    memset(&tap, 0, sizeof(tap));
+    srand((unsigned int) getpid() ^ (unsigned int) time(NULL));
+    for(option = 0; option < MAC_ADDRESS_SIZE; option++) { tap.mac[option] = (unsigned char) rand(); }
+    tap.mac[0] = (tap.mac[0] & 0xfe) | 0x02;
+
+    while((option = getopt(argc, argv, "m:")) != -1) {
+        switch(option) {
+            case 'm':
+                if(tap_mac(optarg, tap.mac) < 0) {
+                    fprintf(stderr, "Invalid mac address '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-m mac] [name]\n", argv[0]);
+                return 1;
+        }
+    }
+    if(optind < argc) { name = argv[optind]; }
+
+    if(tap_open(&tap, name) < 0) { perror("tap"); return 1; }
+    if(tap_init(&tap) < 0) { perror("io_uring"); return 1; }
+
+    signal(SIGINT, tap_signal);
+    signal(SIGTERM, tap_signal);
+
+    printf("Reflecting frames on %s (%s reads)\n", name,
+        tap.multishot ? "multishot" : "fixed");
+    tap_run(&tap);
+
+    printf(
+        "rx_packets %llu tx_packets %llu dropped %llu errors %llu\n",
+        (unsigned long long) tap.rx_packets, (unsigned long long) tap.tx_packets,
+        (unsigned long long) tap.dropped, (unsigned long long) tap.errors
+    );
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ Hive Drivers
+ Copyright (C) 2008-2015 Hive Solutions Lda.
+
+ This file is part of Hive Drivers.
+
+ Hive Drivers is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Hive Drivers is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Hive Drivers. If not, see <http://www.gnu.org/licenses/>.
+
+ __author__    = João Magalhães <joamag@hive.pt>
+ __version__   = 1.0.0
+ __revision__  = $LastChangedRevision$
+ __date__      = $LastChangedDate$
+ __copyright__ = Copyright (c) 2008-2015 Hive Solutions Lda.
+ __license__   = GNU General Public License (GPL), Version 3
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <linux/types.h>
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/icmp.h>
+#include <linux/icmpv6.h>
+
+/* the definitions (types, constants and helpers) of the kernel
+that are required by the protocol code shared with the userspace
+twin of the driver, with the same semantics as the kernel ones */
+
+typedef __u8 u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef __u64 u64;
+
+#define IP_MF 0x2000
+#define IP_OFFSET 0x1fff
+#define NDISC_NEIGHBOUR_SOLICITATION 135
+#define NDISC_NEIGHBOUR_ADVERTISEMENT 136
+#define ND_OPT_TARGET_LL_ADDR 2
+
+/* the byte order conversions of the c library are not constant
+expressions (not usable as case labels) so they are replaced by
+the builtin based ones (folded at compile time) */
+#undef htons
+#undef ntohs
+#undef htonl
+#undef ntohl
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define htons(value) ((__u16) __builtin_bswap16((__u16) (value)))
+#define htonl(value) ((__u32) __builtin_bswap32((__u32) (value)))
+#else
+#define htons(value) ((__u16) (value))
+#define htonl(value) ((__u32) (value))
+#endif
+#define ntohs(value) htons(value)
+#define ntohl(value) htonl(value)
+
+struct sk_buff;
+
+struct nd_msg {
+    struct icmp6hdr icmph;
+    struct in6_addr target;
+    __u8 opt[0];
+};
+
+static inline bool ipv4_is_multicast(__be32 address) {
+    return (address & htonl(0xf0000000)) == htonl(0xe0000000);
+}
+
+static inline bool ipv4_is_lbcast(__be32 address) {
+    return address == htonl(INADDR_BROADCAST);
+}
+
+static inline bool ipv6_addr_is_multicast(const struct in6_addr *address) {
+    return address->s6_addr[0] == 0xff;
+}
+
+static inline bool ipv6_addr_any(const struct in6_addr *address) {
+    return (address->s6_addr32[0] | address->s6_addr32[1] |
+        address->s6_addr32[2] | address->s6_addr32[3]) == 0;
+}
+
+static inline __sum16 csum_fold(__wsum csum) {
+    u32 sum = (u32) csum;
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (__sum16) ~sum;
+}
+
+static inline __wsum csum_partial(const void *buffer, int len, __wsum wsum) {
+    const unsigned char *data = buffer;
+    u64 sum = (u32) wsum;
+    u16 word = 0;
+
+    /* sums the (16 bit) words in memory order, the sum is
+    independent of the byte order (ones complement) */
+    while(len > 1) {
+        memcpy(&word, data, 2);
+        sum += word;
+        data += 2;
+        len -= 2;
+    }
+    if(len == 1) {
+        word = 0;
+        memcpy(&word, data, 1);
+        sum += word;
+    }
+
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    return (__wsum) sum;
+}
+
+static inline __sum16 csum_ipv6_magic(
+    const struct in6_addr *saddr,
+    const struct in6_addr *daddr,
+    __u32 len,
+    unsigned short protocol,
+    __wsum csum
+) {
+    __be32 pseudo[2] = { htonl(len), htonl(protocol) };
+
+    csum = csum_partial(saddr, sizeof(struct in6_addr), csum);
+    csum = csum_partial(daddr, sizeof(struct in6_addr), csum);
+    csum = csum_partial(pseudo, sizeof(pseudo), csum);
+    return csum_fold(csum);
+}
+
+static inline void csum_replace2(__sum16 *sum, __be16 from, __be16 to) {
+    /* incremental update of the checksum (rfc 1624) */
+    u32 value = (u16) ~*sum + (u16) ~from + (u16) to;
+    value = (value & 0xffff) + (value >> 16);
+    value = (value & 0xffff) + (value >> 16);
+    *sum = (__sum16) ~value;
+}
@@ -29,6 +29,49 @@
 
 #include "net_util.h"
 
+/**
+ * The (per cpu) counters of the identifiers of the IPv4
+ * datagrams built by the driver, no state is shared between
+ * the cpus (each one starts at a random value).
+ */
+static DEFINE_PER_CPU(u16, ip_ident);
+
+u32 toeplitz_hash_c(const unsigned char *key, unsigned int key_len, const unsigned char *data, unsigned int len) {
+    /* allocates space for the result and for the current (32 bit)
+    window of the key, that starts with the first four bytes */
+    u32 result = 0;
+    u32 window = (key[0] << 24) | (key[1] << 16) | (key[2] << 8) | key[3];
+    unsigned int index;
+    unsigned int bit;
+
+    /* iterates over each bit of the input, for each set bit the
+    current window of the key is added (xor) to the result, the
+    window is shifted by one bit of the key per input bit */
+    for(index = 0; index < len; index++) {
+        unsigned char next = index + 4 < key_len ? key[index + 4] : 0;
+        for(bit = 0; bit < 8; bit++) {
+            if(data[index] & (0x80 >> bit)) { result ^= window; }
+            window = (window << 1) | ((next >> (7 - bit)) & 0x01);
+        }
+    }
+
+    return result;
+}
+
+void ip_ident_init_c(void) {
+    int cpu;
+
+    for_each_possible_cpu(cpu) { per_cpu(ip_ident, cpu) = (u16) prandom_u32(); }
+}
+
+__be16 ip_ident_c(void) {
+    /* the increment is local to the cpu (no atomic operation
+    nor shared cache line), the identifiers of the cpus may
+    overlap but these are only meaningful for a fragmented
+    datagram between a pair of addresses (rfc 6864) */
+    return htons(this_cpu_inc_return(ip_ident));
+}
+
 short icmp_checksum_c(unsigned short *buffer, unsigned int len) {
     unsigned long sum = 0;
     short answer = 0;
@@ -125,21 +168,31 @@ void print_head_c(struct sk_buff *skb) {
 
     N_DEBUG_F("Header (%d): 0x", skb->mac_len);
     for(index = 0; index < skb->mac_len; index++) {
-        unsigned char head_value = skb->head[index + MAC_HEADER_OFFSET];
+        unsigned char head_value = skb_mac_header(skb)[index];
         N_DEBUG_F("%02X ", head_value);
     }
     N_DEBUG("\n");
 }
 
 void print_data_c(struct sk_buff *skb) {
-    /* allocates space for the counter to be
-    used for iterations */
+    /* allocates space for the counters to be
+    used for iterations and for the chunk buffer */
     size_t index;
+    size_t offset;
+    size_t size;
+    unsigned char chunk[PRINT_CHUNK_SIZE];
 
+    /* iterates over the complete buffer in chunks, that are
+    copied from either the linear part or the fragments, so
+    that non linear buffers are printed without linearizing */
     N_DEBUG_F("Data (%d/%d): 0x", skb->len, skb->data_len);
-    for(index = 0; index < skb->len; index++) {
-        unsigned char value = skb->data[index];
-        N_DEBUG_F("%02X ", value);
+    for(offset = 0; offset < skb->len; offset += size) {
+        size = min_t(size_t, skb->len - offset, PRINT_CHUNK_SIZE);
+        if(skb_copy_bits(skb, offset, chunk, size)) { break; }
+        for(index = 0; index < size; index++) {
+            unsigned char value = chunk[index];
+            N_DEBUG_F("%02X ", value);
+        }
     }
     N_DEBUG("\n");
 }
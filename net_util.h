@@ -27,14 +27,21 @@
 
 #pragma once
 
-#define MAC_HEADER_OFFSET 2
 #define MAC_ADDRESS_SIZE 6
 #define IP_ADDRESS_SIZE 4
 #define SUM_ADDRESS_SIZE 10
+#define ARP_PACKET_SIZE 28
+#define TRANSPORT_HEADER_SIZE 8
+#define PRINT_CHUNK_SIZE 16
 
+#define IS_VLAN_REQUEST(mac_header) mac_header[12] == 0x81 && mac_header[13] == 0x00
 #define IS_ARP_REQUEST(mac_header) mac_header[12] == 0x08 && mac_header[13] == 0x06
 #define IS_IP_REQUEST(mac_header) mac_header[12] == 0x08 && mac_header[13] == 0x00
+#define IS_IPV6_REQUEST(mac_header) mac_header[12] == 0x86 && mac_header[13] == 0xdd
 
+u32 toeplitz_hash_c(const unsigned char *key, unsigned int key_len, const unsigned char *data, unsigned int len);
+void ip_ident_init_c(void);
+__be16 ip_ident_c(void);
 short icmp_checksum_c(unsigned short *buffer, unsigned int len);
 unsigned short udp_checksum_c(unsigned short len_udp, unsigned char *src_addr, unsigned char *dest_addr, bool padding, unsigned char *buff);
 void print_addr_c(unsigned char *addr);